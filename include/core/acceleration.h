@@ -0,0 +1,60 @@
+#ifndef RAY_TRACER_ACCELERATION_H
+#define RAY_TRACER_ACCELERATION_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../geometry/base/render_object.h"
+#include "threadPool.h"
+#include "frustum.h"
+
+struct RenderStats;
+
+enum class AccelerationKind {
+    // Chosen per scene by chooseAcceleration
+    Auto,
+    Bvh,
+    Grid,
+    // Every ray tests every object, the reference of the regression harness
+    Linear
+};
+
+// Spatial index over the render objects of a scene that answers the ray queries of the renderer
+class AccelerationStructure {
+public:
+    virtual ~AccelerationStructure() = default;
+
+    // Must be called from outside of the pool, the calling thread waits for the workers
+    virtual void build(const std::vector<RenderObject*>& objects, ThreadPool& threadPool) = 0;
+
+    // Closest hit, with the same semantics as testing every object in order
+    virtual RenderObject* intersect(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const = 0;
+
+    // Any object hit in front of maxDistance, for shadow rays. Stops at the first one found.
+    virtual RenderObject* occluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, float epsilon) const = 0;
+
+    // Parts of the structure that rays inside the frustum can reach, for intersectFrom. Returns false if the
+    // structure cannot be entered below the top, then every ray goes through intersect.
+    virtual bool cullFrustum(const Frustum&, std::vector<uint32_t>&) const {
+        return false;
+    }
+
+    // Closest hit like intersect, for a ray inside the frustum the entries were culled with
+    virtual RenderObject* intersectFrom(const std::vector<uint32_t>&, Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const {
+        return intersect(ray, tMin, ignoredObject, epsilon);
+    }
+
+    // Copy of the structure pointing at a copy of the objects with the same order
+    virtual std::unique_ptr<AccelerationStructure> cloneFor(const std::vector<RenderObject*>& objects) const = 0;
+
+    virtual void recordStats(RenderStats& stats) const = 0;
+};
+
+// The grid for scenes of many spheres of similar size spread through the scene, such as particle dumps,
+// the hierarchy for meshes, for spheres of mixed sizes and for clustered ones
+AccelerationKind chooseAcceleration(const std::vector<RenderObject*>& objects);
+
+const char* accelerationKindName(AccelerationKind kind);
+bool parseAccelerationKind(const char* name, AccelerationKind& kind);
+
+#endif //RAY_TRACER_ACCELERATION_H
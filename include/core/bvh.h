@@ -0,0 +1,96 @@
+#ifndef RAY_TRACER_BVH_H
+#define RAY_TRACER_BVH_H
+
+#include <cstdint>
+#include <vector>
+#include "acceleration.h"
+
+struct BvhNode {
+    float bounds_min[3];
+    float bounds_max[3];
+    // Inner nodes: index of the first child, the second child follows it.
+    // Leaves: index of the first primitive in the primitive index list.
+    uint32_t offset;
+    // Number of primitives of a leaf, zero for inner nodes
+    uint16_t count;
+    // Split axis of an inner node, used to visit the nearer child first
+    uint16_t axis;
+};
+
+// Eight-wide node whose child boxes are quantized to 8 bits on a power-of-two grid anchored at origin
+struct CompressedBvhNode {
+    float origin[3];
+    int8_t exponent[3];
+    uint8_t padding;
+    uint8_t quantized_min[3][8];
+    uint8_t quantized_max[3][8];
+    // Inner children are stored consecutively from first_child, leaf primitives from first_primitive
+    uint32_t first_child;
+    uint32_t first_primitive;
+    // Zero for inner children, number of primitives for leaves, 0xff for unused slots
+    uint8_t child_primitive_count[8];
+    // Inner children: position after first_child, leaves: position after first_primitive
+    uint8_t child_offset[8];
+};
+
+enum class BvhLayout {
+    Binary,
+    Compressed
+};
+
+struct BvhStats {
+    BvhLayout layout = BvhLayout::Binary;
+    double build_seconds = 0;
+    size_t primitive_count = 0;
+    size_t node_count = 0;
+    size_t leaf_count = 0;
+    int max_depth = 0;
+    // Expected cost of a random ray, relative to intersecting a single primitive
+    float sah_cost = 0;
+    size_t memory_bytes = 0;
+};
+
+// Bounding volume hierarchy over the render objects of a scene, built top-down with a binned
+// surface area heuristic. The upper levels are split breadth-first with the binning of large
+// nodes spread over the thread pool; the remaining subtrees are then built by the workers.
+// The compressed layout collapses the finished binary tree into eight-wide quantized nodes, which
+// take a fraction of the memory at the cost of decoding the child boxes during traversal.
+class Bvh : public AccelerationStructure {
+public:
+    explicit Bvh(BvhLayout layout = BvhLayout::Binary);
+
+    void build(const std::vector<RenderObject*>& objects, ThreadPool& threadPool) override;
+    RenderObject* intersect(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const override;
+    RenderObject* occluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, float epsilon) const override;
+    // Entries are at most a few subtrees of the binary layout ordered from near to far, the compressed layout is not culled
+    bool cullFrustum(const Frustum& frustum, std::vector<uint32_t>& entries) const override;
+    RenderObject* intersectFrom(const std::vector<uint32_t>& entries, Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const override;
+    std::unique_ptr<AccelerationStructure> cloneFor(const std::vector<RenderObject*>& objects) const override;
+    void recordStats(RenderStats& stats) const override;
+
+    const BvhStats& getStats() const;
+
+private:
+    void computeStats();
+    void collapse();
+    // tMin starts as the farthest distance of interest. With AnyHit the first object in front of it is returned.
+    // Binary traversal starts from the entry nodes, the first one is visited first.
+    template <bool AnyHit>
+    RenderObject* intersectBinary(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon,
+                                  const uint32_t* entries, size_t entryCount) const;
+    template <bool AnyHit>
+    RenderObject* intersectCompressed(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const;
+
+    const std::vector<RenderObject*>* objects = nullptr;
+    BvhLayout layout = BvhLayout::Binary;
+    TrackedVector<BvhNode, MemoryCategory::Acceleration> nodes;
+    TrackedVector<CompressedBvhNode, MemoryCategory::Acceleration> compressed_nodes;
+    // Indices into objects, in leaf order
+    TrackedVector<uint32_t, MemoryCategory::Acceleration> primitive_indices;
+    BvhStats stats;
+};
+
+const char* bvhLayoutName(BvhLayout layout);
+bool parseBvhLayout(const char* name, BvhLayout& layout);
+
+#endif //RAY_TRACER_BVH_H
@@ -0,0 +1,21 @@
+#ifndef RAY_TRACER_FRUSTUM_H
+#define RAY_TRACER_FRUSTUM_H
+
+#include "../utilities.h"
+
+// Pyramid of the camera rays through a rectangle of the image plane, with its apex at the camera
+struct Frustum {
+    float apex[3];
+    // Side planes, a point p is inside if normal . p + offset >= 0 for all four of them
+    float normal[4][3];
+    float offset[4];
+
+    // Whether the box may hold points of the frustum. Conservative, boxes just outside a corner pass.
+    bool overlaps(const float min[3], const float max[3]) const;
+};
+
+// Frustum of the camera rays through the pixels from startX up to endX and from startY up to endY,
+// widened by a pixel on every side so that no sample of these pixels falls outside of it
+Frustum tileFrustum(const Camera& camera, int startX, int endX, int startY, int endY);
+
+#endif //RAY_TRACER_FRUSTUM_H
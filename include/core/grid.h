@@ -0,0 +1,63 @@
+#ifndef RAY_TRACER_GRID_H
+#define RAY_TRACER_GRID_H
+
+#include <cstdint>
+#include <vector>
+#include "acceleration.h"
+#include "memoryTracker.h"
+
+// One uniform grid, the top level over the scene or a sub-grid over a single crowded top cell
+struct GridLevel {
+    float bounds_min[3];
+    float bounds_max[3];
+    float cell_size[3];
+    float inverse_cell_size[3];
+    int resolution[3];
+    // Index of the level's first cell in Grid::cell_start
+    uint32_t first_cell;
+};
+
+struct GridStats {
+    double build_seconds = 0;
+    size_t primitive_count = 0;
+    int resolution[3] = {0, 0, 0};
+    size_t cell_count = 0;
+    size_t subgrid_count = 0;
+    // Cell entries per primitive, primitives are listed in every cell their box overlaps
+    float references_per_primitive = 0;
+    size_t memory_bytes = 0;
+};
+
+// Two-level uniform grid traversed with a 3D-DDA. The top level has about one cell per two primitives;
+// top cells that still hold many primitives get a finer grid of their own, which keeps clustered
+// regions cheap without paying for fine cells in the empty parts of the scene. Cells are never made
+// smaller than the median primitive, which would only list the same primitives in more cells.
+class Grid : public AccelerationStructure {
+public:
+    void build(const std::vector<RenderObject*>& objects, ThreadPool& threadPool) override;
+    RenderObject* intersect(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const override;
+    RenderObject* occluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, float epsilon) const override;
+    std::unique_ptr<AccelerationStructure> cloneFor(const std::vector<RenderObject*>& objects) const override;
+    void recordStats(RenderStats& stats) const override;
+
+    const GridStats& getStats() const;
+
+private:
+    template <bool AnyHit>
+    RenderObject* traverse(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const;
+
+    const std::vector<RenderObject*>* objects = nullptr;
+    TrackedVector<GridLevel, MemoryCategory::Acceleration> levels;
+    // Primitives of cell c are cell_primitives[cell_start[c]] up to cell_primitives[cell_start[c + 1]]
+    TrackedVector<uint32_t, MemoryCategory::Acceleration> cell_start;
+    TrackedVector<uint32_t, MemoryCategory::Acceleration> cell_primitives;
+    // Level of the sub-grid of every top cell, zero for cells that list their primitives directly
+    TrackedVector<uint32_t, MemoryCategory::Acceleration> subgrid;
+    GridStats stats;
+};
+
+// Resolution of a grid of about cells roughly cubic cells over the box from min to max, with cells
+// no smaller than minimumSide
+void gridResolution(const float min[3], const float max[3], float cells, float minimumSide, int resolution[3]);
+
+#endif //RAY_TRACER_GRID_H
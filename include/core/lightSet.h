@@ -0,0 +1,49 @@
+#ifndef RAY_TRACER_LIGHTSET_H
+#define RAY_TRACER_LIGHTSET_H
+
+#include <vector>
+#include "../utilities.h"
+
+// Surface point seen by a ray, everything the light loop needs besides the lights
+struct ShadingPoint {
+    Vec3f position;
+    Vec3f normal;
+    // Unit vector from the surface towards the ray origin
+    Vec3f to_viewer;
+    Vec3f diffuse;
+    Vec3f specular;
+    float phong_exponent;
+};
+
+// Unshadowed light of one batch, lane i belongs to light first + i
+struct LightBatch {
+    static const int width = 4;
+
+    // Unit vector from the surface point towards the light and the distance to it
+    float direction_x[width], direction_y[width], direction_z[width];
+    float distance[width];
+    // Diffuse plus specular light reaching the eye, zero for the padding lanes
+    float red[width], green[width], blue[width];
+};
+
+// Point lights as a structure of arrays, so that a whole batch of lights is shaded with one
+// set of vector instructions. Padded with dark lights to a whole number of batches.
+class LightSet {
+public:
+    void assign(const std::vector<PointLight>& lights);
+
+    // Number of real lights
+    size_t size() const;
+    // Number of lanes including the padding, a multiple of LightBatch::width
+    size_t paddedSize() const;
+
+    // Blinn-Phong diffuse and specular terms of the lights [first, first + LightBatch::width)
+    void shade(size_t first, const ShadingPoint& point, LightBatch& batch) const;
+
+private:
+    size_t count = 0;
+    std::vector<float> position_x, position_y, position_z;
+    std::vector<float> intensity_x, intensity_y, intensity_z;
+};
+
+#endif //RAY_TRACER_LIGHTSET_H
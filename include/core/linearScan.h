@@ -0,0 +1,20 @@
+#ifndef RAY_TRACER_LINEARSCAN_H
+#define RAY_TRACER_LINEARSCAN_H
+
+#include "acceleration.h"
+
+// No index at all: every ray tests every object in scene order. Far too slow for real scenes, but its
+// hits are the definition the other structures must reproduce, which makes it the regression reference.
+class LinearScan : public AccelerationStructure {
+public:
+    void build(const std::vector<RenderObject*>& objects, ThreadPool& threadPool) override;
+    RenderObject* intersect(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const override;
+    RenderObject* occluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, float epsilon) const override;
+    std::unique_ptr<AccelerationStructure> cloneFor(const std::vector<RenderObject*>& objects) const override;
+    void recordStats(RenderStats& stats) const override;
+
+private:
+    const std::vector<RenderObject*>* objects = nullptr;
+};
+
+#endif //RAY_TRACER_LINEARSCAN_H
@@ -0,0 +1,84 @@
+#ifndef RAY_TRACER_MEMORYTRACKER_H
+#define RAY_TRACER_MEMORYTRACKER_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// Parts of a run whose memory is accounted separately
+enum class MemoryCategory {
+    // Scene::vertex_data
+    VertexData,
+    // The scene arenas holding the objects of Scene::render_objects and their copies
+    Primitives,
+    // Acceleration structures, including the temporary buffers of their builds
+    Acceleration,
+    // Images and visibility buffers
+    Framebuffers,
+    // Scene files and meshes while they are being parsed
+    ParserBuffers,
+    Count
+};
+
+struct MemoryUsage {
+    size_t current_bytes = 0;
+    size_t peak_bytes = 0;
+};
+
+// Process wide byte counts per category, updated by the tracked allocations below. Thread safe.
+class MemoryTracker {
+public:
+    static void allocated(MemoryCategory category, size_t bytes);
+    static void released(MemoryCategory category, size_t bytes);
+
+    static MemoryUsage usage(MemoryCategory category);
+    // All categories together. The peak is of the sum, not the sum of the peaks.
+    static MemoryUsage total();
+
+    static void print(std::ostream& out);
+};
+
+const char* memoryCategoryName(MemoryCategory category);
+
+// std::allocator that reports what it hands out to the tracker
+template <class T, MemoryCategory Category>
+struct TrackedAllocator {
+    using value_type = T;
+
+    template <class U>
+    struct rebind {
+        using other = TrackedAllocator<U, Category>;
+    };
+
+    TrackedAllocator() = default;
+
+    template <class U>
+    TrackedAllocator(const TrackedAllocator<U, Category>&) {}
+
+    T* allocate(size_t count) {
+        T* memory = std::allocator<T>().allocate(count);
+        MemoryTracker::allocated(Category, count * sizeof(T));
+        return memory;
+    }
+
+    void deallocate(T* memory, size_t count) {
+        MemoryTracker::released(Category, count * sizeof(T));
+        std::allocator<T>().deallocate(memory, count);
+    }
+
+    template <class U>
+    bool operator==(const TrackedAllocator<U, Category>&) const {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const TrackedAllocator<U, Category>&) const {
+        return false;
+    }
+};
+
+template <class T, MemoryCategory Category>
+using TrackedVector = std::vector<T, TrackedAllocator<T, Category>>;
+
+#endif //RAY_TRACER_MEMORYTRACKER_H
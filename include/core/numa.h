@@ -0,0 +1,32 @@
+#ifndef RAY_TRACER_NUMA_H
+#define RAY_TRACER_NUMA_H
+
+#include <vector>
+#include "threadPool.h"
+
+// Where the workers of the render pool run
+enum class ThreadPlacement {
+    // Left to the operating system
+    None,
+    // Every worker pinned to one CPU, spread over the NUMA nodes
+    Cores,
+    // Every worker pinned to the CPUs of one NUMA node, spread over the nodes
+    NumaNodes
+};
+
+struct NumaTopology {
+    // CPUs of every NUMA node this process may run on. A single node with every
+    // CPU where the topology is not known.
+    std::vector<std::vector<int>> node_cpus;
+
+    static NumaTopology detect();
+};
+
+// Worker placements for a pool of threadCount workers. Workers of the same NUMA node share a group,
+// and groups are numbered densely from zero.
+std::vector<WorkerPlacement> placeWorkers(const NumaTopology& topology, ThreadPlacement placement, size_t threadCount);
+
+const char* threadPlacementName(ThreadPlacement placement);
+bool parseThreadPlacement(const char* name, ThreadPlacement& placement);
+
+#endif //RAY_TRACER_NUMA_H
@@ -0,0 +1,32 @@
+#ifndef RAY_TRACER_PERFCOUNTERS_H
+#define RAY_TRACER_PERFCOUNTERS_H
+
+#include <cstdint>
+
+struct CacheCounterValues {
+    bool available = false;
+    uint64_t l1_accesses = 0;
+    uint64_t l1_misses = 0;
+    uint64_t llc_accesses = 0;
+    uint64_t llc_misses = 0;
+};
+
+// Hardware data cache counters of the calling thread and every thread it creates
+// after construction. Counting silently does nothing when the platform or the
+// kernel settings (perf_event_paranoid) do not allow it.
+class CacheCounters {
+public:
+    CacheCounters();
+    ~CacheCounters();
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+
+    // Values are complete once the counted threads have exited
+    CacheCounterValues read() const;
+
+private:
+    static const int counterCount = 4;
+    int fds[counterCount];
+};
+
+#endif //RAY_TRACER_PERFCOUNTERS_H
@@ -0,0 +1,53 @@
+#ifndef RAY_TRACER_RASTERIZER_H
+#define RAY_TRACER_RASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+#include "../geometry/base/render_object.h"
+#include "threadPool.h"
+
+// How the renderer finds the object seen through each pixel
+enum class PrimaryVisibility {
+    RayTraced,
+    Rasterized
+};
+
+// object_id of the pixels the rasterizer cannot decide exactly, they are left to a camera ray
+const int unresolvedObject = -2;
+
+struct VisibilitySample {
+    // Index into Scene::render_objects, -1 where the camera ray misses every object
+    int object_id;
+    // Distance along the camera ray
+    float depth;
+};
+
+class VisibilityBuffer {
+public:
+    VisibilityBuffer(int width, int height);
+    VisibilitySample& at(int x, int y);
+    const VisibilitySample& at(int x, int y) const;
+
+    int width;
+    int height;
+
+private:
+    TrackedVector<VisibilitySample, MemoryCategory::Framebuffers> samples;
+};
+
+// Primary visibility without camera rays. Triangles are clipped in front of the eye, projected and scanned
+// with edge functions and a perspective correct depth test; spheres are tested exactly, but only inside
+// their conservatively projected bounds. Only the closest candidate of a pixel is intersected with its
+// camera ray, which gives the same depth as raycast. Pixels too close to an edge or to a second surface
+// for the raster to be sure, or whose candidate the ray misses, are left unresolved.
+class Rasterizer {
+public:
+    // Must be called from outside of the pool, the calling thread waits for the workers. Returns the
+    // number of unresolved pixels.
+    uint64_t rasterize(const Scene& scene, const Camera& camera, ThreadPool& threadPool, VisibilityBuffer& buffer) const;
+};
+
+const char* primaryVisibilityName(PrimaryVisibility visibility);
+bool parsePrimaryVisibility(const char* name, PrimaryVisibility& visibility);
+
+#endif //RAY_TRACER_RASTERIZER_H
@@ -2,9 +2,19 @@
 #define RAYTRACER_H
 
 #include <vector>
+#include <atomic>
+#include <functional>
 #include "../geometry/triangle.h"
 #include "../geometry/sphere.h"
 #include "threadPool.h"
+#include "bvh.h"
+#include "grid.h"
+#include "linearScan.h"
+#include "rasterizer.h"
+#include "numa.h"
+#include "lightSet.h"
+#include "tiling.h"
+#include "renderStats.h"
 
 class RenderResult {
 public:
@@ -19,31 +29,98 @@ public:
 	int height;
 };
 
+struct RenderSettings {
+	unsigned int thread_count = 4;
+	TileOrder tile_order = TileOrder::Hilbert;
+	// Rounded up to a power of two so that the pixels of a tile can be visited in z-order
+	int tile_size = 16;
+	TileSchedule tile_schedule = TileSchedule::CostFirst;
+	// Cull the acceleration structure to the frustum of every tile before tracing its camera rays
+	bool tile_culling = true;
+	AccelerationKind acceleration = AccelerationKind::Auto;
+	// Layout of the hierarchy, when the acceleration structure is one
+	BvhLayout bvh_layout = BvhLayout::Binary;
+	// Rasterized visibility replaces the camera rays, shading still traces shadow and mirror rays
+	PrimaryVisibility primary_visibility = PrimaryVisibility::RayTraced;
+	// Antialiasing with antialiasing x antialiasing rays per pixel
+	int antialiasing = 1;
+	// Wall clock budget of a progressive render in seconds, zero for none
+	double deadline_seconds = 0;
+	ThreadPlacement thread_placement = ThreadPlacement::None;
+	// Give every NUMA node its own copy of the geometry and the BVH
+	bool replicate_scene = false;
+};
+
+// Copy of the geometry and the acceleration structure, allocated by the workers of one NUMA node
+struct SceneReplica {
+	SceneArena arena;
+	std::vector<RenderObject*> objects;
+	std::unique_ptr<AccelerationStructure> acceleration;
+};
+
+// Quality of one pass over every tile of every camera
+struct RenderPass {
+	// Distance between the traced pixels, the pixels in between copy the sample
+	int pixel_step;
+	int sample_grid;
+	int recursion_limit;
+	// Tiles of the pass are skipped once the deadline has passed
+	bool deadline_bound;
+};
+
 class RayTracer {
-	Scene scene;
+	// Shared with the caller and any other renderer, never changed
+	std::shared_ptr<const Scene> scene;
+	std::unique_ptr<AccelerationStructure> acceleration;
+	LightSet lights;
+	// One per pool group when the scene is replicated, empty otherwise
+	std::vector<std::unique_ptr<SceneReplica>> replicas;
+	RenderSettings settings;
+	RenderStats stats;
+	std::atomic<uint64_t> rayCount;
+	std::atomic<uint64_t> shadowRayCount;
+	std::atomic<uint64_t> blockedShadowRays;
+	std::atomic<uint64_t> occluderHits;
+	std::atomic<uint64_t> culledTiles;
+	std::atomic<uint64_t> tileEntryCount;
+	// Maximum ray depth of the current pass
+	int recursionLimit = 0;
+	// Seconds the last pass that rendered them spent on every tile of every camera. They order the tiles
+	// of the next pass, or of the next render as long as its cameras have the same tiles.
+	std::vector<std::vector<float>> tileSeconds;
 
 public:
-	vector<RenderResult*> render(const Scene&);
+	// Called on the rendering thread after every completed pass, while no worker writes to the images
+	using PassCallback = std::function<void(const vector<RenderResult*>& results, int pass)>;
+	// Called on the worker that finishes the last tile of a camera, once its image is complete. Other
+	// cameras are still rendering then, and callbacks of different cameras may run at the same time.
+	using CameraCallback = std::function<void(RenderResult* result, size_t camera)>;
+
+	explicit RayTracer(const RenderSettings& settings = RenderSettings());
+	vector<RenderResult*> render(const std::shared_ptr<const Scene>& scene, const CameraCallback& onCamera = nullptr);
+	// Renders a coarse preview first, then refines the tiles to full resolution, full recursion depth and
+	// antialiasing until every tile is done or settings.deadline_seconds is reached
+	vector<RenderResult*> renderProgressive(const std::shared_ptr<const Scene>& scene, const PassCallback& onPass);
+	const RenderStats& getStats() const;
+	static Ray calculateRayFromCamera(const Camera& camera, int x, int y);
+	static Ray calculateSubpixelRay(const Camera& camera, float x, float y);
 
 private:
-	Ray calculateRayFromCamera(const Camera& camera, int x, int y);
     RenderObject* raycast(Ray* ray, float& tMin, RenderObject* ignoredObject);
-	Vec3f calculateDiffuse(const Material& mat, const Ray& rayFromLight, const Vec3f& surfaceNormal, const PointLight& light, const Vec3f& intersectionPoint);
-    Vec3f calculateIrradiance(const PointLight& pointLight, const Vec3f& intersectionPoint);
+    bool isOccluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, size_t lightIndex);
 	Vec3f clamp(Vec3f& x);
 
-    Vec3f
-    calculateSpecular(const Material &mat, const PointLight &pointLight,
-                      const Vec3f &rayDirectionFromIntersectionToLight,
-                      const Vec3f &rayDirectionFromIntersectionToCamera, const Vec3f &intersectionPoint,
-                      const Vec3f &intersectionNormal);
-
     Vec3f applyShading(RenderObject *hitObject, Ray* ray, const float &tHit);
 
     Vec3f computeColor(Ray *ray, RenderObject* ignoredObject);
+    Vec3f shadeHit(Ray* ray, RenderObject* hitObject, float tHit);
+
+    void replicateScene(ThreadPool& threadPool);
+    void bindWorkerScene();
+    Vec3f computePixelColor(const Camera& camera, int x, int y, const VisibilityBuffer* visibility, int sampleGrid);
 
-    void
-    renderPartial(const Scene &scene, Camera camera, RenderResult *result, int startX, int endX, int startY, int endY);
+    vector<RenderResult*> renderPasses(const std::vector<RenderPass>& passes, const PassCallback& onPass, const CameraCallback& onCamera);
+    void renderPartial(const Camera& camera, RenderResult* result, const Tile& tile, const VisibilityBuffer* visibility, const RenderPass& pass);
 };
 
 #endif // RAYTRACER_H
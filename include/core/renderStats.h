@@ -0,0 +1,60 @@
+#ifndef RAY_TRACER_RENDERSTATS_H
+#define RAY_TRACER_RENDERSTATS_H
+
+#include <cstdint>
+#include <ostream>
+#include "perfCounters.h"
+#include "tiling.h"
+#include "bvh.h"
+#include "grid.h"
+#include "rasterizer.h"
+#include "numa.h"
+
+struct RenderStats {
+    unsigned int thread_count = 0;
+    ThreadPlacement thread_placement = ThreadPlacement::None;
+    size_t numa_groups = 1;
+    bool replicated = false;
+    TileOrder tile_order = TileOrder::Scanline;
+    int tile_size = 0;
+    TileSchedule tile_schedule = TileSchedule::Ordered;
+    // Tiles were ordered by the costs measured by the previous render rather than by a probe
+    bool reused_tile_costs = false;
+    PrimaryVisibility primary_visibility = PrimaryVisibility::RayTraced;
+
+    uint64_t pass_count = 0;
+    uint64_t tile_count = 0;
+    uint64_t skipped_tile_count = 0;
+    uint64_t pixel_count = 0;
+    uint64_t ray_count = 0;
+    // Included in ray_count
+    uint64_t shadow_ray_count = 0;
+    uint64_t blocked_shadow_ray_count = 0;
+    // Shadow rays blocked by the object that last blocked the same light on the same worker
+    uint64_t occluder_cache_hits = 0;
+    // Tiles whose camera rays started from the parts of the acceleration structure inside their frustum,
+    // and the number of those parts over all of them
+    uint64_t culled_tile_count = 0;
+    uint64_t tile_entry_count = 0;
+    double render_seconds = 0;
+    double raster_seconds = 0;
+    // Pixels the rasterizer left to camera rays
+    uint64_t raster_unresolved_pixels = 0;
+    // Wall time of the passes and the probe, and the time all workers together spent on their tiles
+    double pass_seconds = 0;
+    double tile_seconds = 0;
+    double probe_seconds = 0;
+
+    CacheCounterValues cache;
+    AccelerationKind acceleration = AccelerationKind::Bvh;
+    // Chosen by chooseAcceleration rather than by the settings
+    bool acceleration_automatic = false;
+    double acceleration_build_seconds = 0;
+    // Only the one of the structure in use is filled in
+    BvhStats bvh;
+    GridStats grid;
+
+    void print(std::ostream& out) const;
+};
+
+#endif //RAY_TRACER_RENDERSTATS_H
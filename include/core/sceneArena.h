@@ -0,0 +1,54 @@
+#ifndef RAY_TRACER_SCENEARENA_H
+#define RAY_TRACER_SCENEARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include "memoryTracker.h"
+
+// Owns the primitives of a scene in a few large blocks. Objects are placed one after the other and keep
+// their address until the arena goes away, which releases the blocks without running any destructor,
+// so the objects must not own memory of their own. Blocks grow with the arena, a scene of n objects
+// takes O(log n) of them. Counted as primitive memory. Not thread safe.
+class SceneArena {
+public:
+    SceneArena() = default;
+    SceneArena(const SceneArena&) = delete;
+    SceneArena& operator=(const SceneArena&) = delete;
+    SceneArena(SceneArena&& other) noexcept;
+    SceneArena& operator=(SceneArena&& other) noexcept;
+    ~SceneArena();
+
+    template <class T, class... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Makes sure the next bytes of objects fit into the current block, so a mesh whose size is known
+    // ends up contiguous
+    void reserve(size_t bytes);
+
+    // Bytes taken by the objects and held by the blocks
+    size_t usedBytes() const;
+    size_t capacityBytes() const;
+
+private:
+    struct Block {
+        char* memory;
+        size_t size;
+    };
+
+    void* allocate(size_t size, size_t alignment);
+    void addBlock(size_t minimumSize);
+    void release();
+
+    std::vector<Block> blocks;
+    // Free space of the last block
+    char* next = nullptr;
+    char* end = nullptr;
+    size_t used_bytes = 0;
+    size_t capacity_bytes = 0;
+};
+
+#endif //RAY_TRACER_SCENEARENA_H
@@ -9,22 +9,53 @@
 #include <mutex>
 #include <condition_variable>
 #include <future>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct WorkerPlacement {
+    // Group whose queues the worker serves first, e.g. its NUMA node. Every group from
+    // zero to the largest one used needs at least one worker.
+    size_t group = 0;
+    // CPUs the worker is pinned to, empty for no pinning
+    std::vector<int> cpus;
+};
 
 class ThreadPool {
 public:
-    ThreadPool(size_t numThreads) {
-        for (size_t i = 0; i < numThreads; i++) {
-            threads.emplace_back([this] {
+    ThreadPool(size_t numThreads) : ThreadPool(std::vector<WorkerPlacement>(numThreads)) {}
+
+    explicit ThreadPool(const std::vector<WorkerPlacement>& placements) {
+        for (const WorkerPlacement& placement : placements) {
+            groupCount = std::max(groupCount, placement.group + 1);
+        }
+        groups.resize(groupCount);
+
+        for (const WorkerPlacement& placement : placements) {
+            size_t group = placement.group;
+            std::vector<int> cpus = placement.cpus;
+            threads.emplace_back([this, group, cpus] {
+                // Pinned before the first task, so everything the worker allocates is local to it
+                pin(cpus);
+                currentGroupSlot() = group;
                 while (true) {
                     std::function<void()> task;
                     {
                         std::unique_lock<std::mutex> lock(queueMutex);
-                        condition.wait(lock, [this] { return stop || !tasks.empty(); });
-                        if (stop && tasks.empty()) {
+                        std::queue<std::function<void()>>* source = nullptr;
+                        condition.wait(lock, [this, group, &source] {
+                            source = findTasks(group);
+                            return stop || source != nullptr;
+                        });
+                        if (source == nullptr) {
                             return;
                         }
-                        task = std::move(tasks.front());
-                        tasks.pop();
+                        task = std::move(source->front());
+                        source->pop();
                     }
                     task();
                 }
@@ -34,6 +65,54 @@ public:
 
     template <class F, class... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+        return push(sharedTasks, false, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // Queues a task for the workers of a group. Other workers only take it once they run out of work,
+    // unless the task is pinned, then only the group runs it.
+    template <class F, class... Args>
+    auto enqueueOn(size_t group, bool pinned, F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+        Group& target = groups[group % groupCount];
+        return push(pinned ? target.pinnedTasks : target.tasks, pinned, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    size_t groupsCount() const {
+        return groupCount;
+    }
+
+    // Group of the calling worker, zero outside of any pool
+    static size_t currentGroup() {
+        return currentGroupSlot();
+    }
+
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            stop = true;
+        }
+        condition.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct Group {
+        std::queue<std::function<void()>> pinnedTasks;
+        std::queue<std::function<void()>> tasks;
+    };
+
+    static size_t& currentGroupSlot() {
+        static thread_local size_t group = 0;
+        return group;
+    }
+
+    template <class F, class... Args>
+    auto push(std::queue<std::function<void()>>& queue, bool pinned, F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
         auto task = std::make_shared<std::packaged_task<decltype(f(args...))()>>(
                 std::bind(std::forward<F>(f), std::forward<Args>(args)...)
         );
@@ -44,26 +123,57 @@ public:
             if (stop) {
                 throw std::runtime_error("enqueue on stopped ThreadPool");
             }
-            tasks.emplace([task]() { (*task)(); });
+            queue.emplace([task]() { (*task)(); });
+        }
+        // A pinned task may only be runnable by a few of the workers, so wake everyone
+        if (pinned) {
+            condition.notify_all();
+        }
+        else {
+            condition.notify_one();
         }
-        condition.notify_one();
         return res;
     }
 
-    ~ThreadPool() {
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            stop = true;
+    // Own group first, then tasks for anyone, then work left over by the other groups.
+    // Called with the lock held, returns nullptr if there is nothing this worker may run.
+    std::queue<std::function<void()>>* findTasks(size_t group) {
+        if (!groups[group].pinnedTasks.empty()) {
+            return &groups[group].pinnedTasks;
         }
-        condition.notify_all();
-        for (std::thread& thread : threads) {
-            thread.join();
+        if (!groups[group].tasks.empty()) {
+            return &groups[group].tasks;
+        }
+        if (!sharedTasks.empty()) {
+            return &sharedTasks;
+        }
+        for (size_t i = 1; i < groupCount; i++) {
+            Group& other = groups[(group + i) % groupCount];
+            if (!other.tasks.empty()) {
+                return &other.tasks;
+            }
         }
+        return nullptr;
+    }
+
+    static void pin(const std::vector<int>& cpus) {
+#ifdef __linux__
+        if (cpus.empty()) {
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+#endif
     }
 
-private:
     std::vector<std::thread> threads;
-    std::queue<std::function<void()>> tasks;
+    std::vector<Group> groups;
+    size_t groupCount = 1;
+    std::queue<std::function<void()>> sharedTasks;
     std::mutex queueMutex;
     std::condition_variable condition;
     bool stop = false;
@@ -0,0 +1,44 @@
+#ifndef RAY_TRACER_TILING_H
+#define RAY_TRACER_TILING_H
+
+#include <cstdint>
+#include <vector>
+
+// Order in which the screen tiles of a camera are handed to the workers.
+enum class TileOrder {
+    Scanline,
+    Morton,
+    Hilbert
+};
+
+// How the tiles of all cameras of a pass are queued for the workers
+enum class TileSchedule {
+    // Camera after camera, each camera's tiles in the tile order
+    Ordered,
+    // Most expensive tile first, estimated from the previous pass or render, or from a sparse probe
+    CostFirst
+};
+
+struct Tile {
+    int startX, endX;
+    int startY, endY;
+};
+
+// Splits a width x height image into tileSize x tileSize tiles (edge tiles are clipped)
+// and returns them in the requested traversal order.
+std::vector<Tile> generateTiles(int width, int height, int tileSize, TileOrder order);
+
+// Z-order (Morton) index of a 2D coordinate and its inverse.
+uint32_t encodeMorton(uint32_t x, uint32_t y);
+void decodeMorton(uint32_t index, uint32_t& x, uint32_t& y);
+
+// Position along a Hilbert curve filling a gridSize x gridSize square (gridSize is a power of two).
+uint32_t encodeHilbert(uint32_t gridSize, uint32_t x, uint32_t y);
+
+const char* tileOrderName(TileOrder order);
+bool parseTileOrder(const char* name, TileOrder& order);
+
+const char* tileScheduleName(TileSchedule schedule);
+bool parseTileSchedule(const char* name, TileSchedule& schedule);
+
+#endif //RAY_TRACER_TILING_H
@@ -5,11 +5,17 @@
 #include <vector>
 #include <math.h>
 
+// Render objects live in a SceneArena and are never changed once imported, so that any number of
+// threads and renders can share them
 class RenderObject{
 public:
+    virtual ~RenderObject() = default;
     int material_id;
-    virtual Vec3f getNormal(const Scene& scene, const Vec3f& intersectionPoint);
-    virtual bool intersect(Ray* ray, float& t, const float& epsilon) = 0;
+    virtual Vec3f getNormal(const Scene& scene, const Vec3f& intersectionPoint) const;
+    virtual bool intersect(Ray* ray, float& t, const float& epsilon) const = 0;
+    virtual BoundingBox getBounds() const = 0;
+    // Copy of the object placed in the given arena
+    virtual RenderObject* cloneInto(SceneArena& arena) const = 0;
 };
 
 #endif //RAY_TRACER_RENDER_OBJECT_H
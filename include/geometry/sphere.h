@@ -6,10 +6,14 @@
 class Sphere : public RenderObject
 {
 public:
+    Sphere(int materialId, const Vec3f& center, float sphereRadius);
+
     Vec3f center_vertex;
     float radius;
-    Vec3f getNormal(const Scene& scene, const Vec3f& intersectionPoint) override;
-    bool intersect(Ray* ray, float &t, const float& epsilon) override;
+    Vec3f getNormal(const Scene& scene, const Vec3f& intersectionPoint) const override;
+    bool intersect(Ray* ray, float &t, const float& epsilon) const override;
+    BoundingBox getBounds() const override;
+    RenderObject* cloneInto(SceneArena& arena) const override;
 };
 
 
@@ -6,15 +6,17 @@
 class Triangle : public RenderObject
 {
 public:
+    // The normal is computed here, rendering only reads it
+    Triangle(int materialId, const Vec3f& v0, const Vec3f& v1, const Vec3f& v2);
+
     Vec3f vertex_0;
     Vec3f vertex_1;
     Vec3f vertex_2;
     Vec3f normal;
-    Vec3f getNormal(const Scene& scene, const Vec3f& intersectionPoint) override;
-    bool intersect(Ray* ray, float &t, const float& epsilon) override;
-
-private:
-    bool isCalculated = false;
+    Vec3f getNormal(const Scene& scene, const Vec3f& intersectionPoint) const override;
+    bool intersect(Ray* ray, float &t, const float& epsilon) const override;
+    BoundingBox getBounds() const override;
+    RenderObject* cloneInto(SceneArena& arena) const override;
 };
 
 
@@ -0,0 +1,30 @@
+#ifndef RAY_TRACER_ARGUMENTS_H
+#define RAY_TRACER_ARGUMENTS_H
+
+#include <string>
+#include "../core/raytracer.h"
+#include "regression.h"
+
+struct Arguments {
+    std::string scene_path;
+    RenderSettings settings;
+    bool print_stats = false;
+    // Print the current and peak memory of every category at the end of the run
+    bool print_memory = false;
+    // Export the images after every pass of a progressive render
+    bool progressive = false;
+    // Name of the benchmark to run instead of exporting the images, empty for a normal render
+    std::string benchmark;
+    // Run the regression harness instead of a render when its baseline path is set
+    RegressionSettings regression;
+};
+
+// Usage: raytracer <scene.xml> [--threads=N] [--tile-size=N] [--tile-order=scanline|morton|hilbert] [--schedule=ordered|cost]
+//                              [--no-tile-culling] [--accel=auto|bvh|grid|linear] [--bvh-layout=binary|compressed] [--primary=raytrace|raster] [--aa=N]
+//                              [--progressive [--deadline-ms=N]] [--pin=none|cores|numa] [--replicate]
+//                              [--stats] [--memory] [--benchmark=bvh-layout|placement|schedule]
+//        raytracer --regression=<baseline> [scene.xml ...] [--update-baseline] [--tolerance=N] [--max-slowdown=PERCENT]
+//                                          [--runs=N] [render options]
+Arguments parseArguments(int argc, char* argv[]);
+
+#endif //RAY_TRACER_ARGUMENTS_H
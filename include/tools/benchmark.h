@@ -0,0 +1,21 @@
+#ifndef RAY_TRACER_BENCHMARK_H
+#define RAY_TRACER_BENCHMARK_H
+
+#include <ostream>
+#include "../core/raytracer.h"
+
+class Benchmark {
+public:
+    // Renders the scene once per BVH layout and compares memory, build and render speed and the images
+    void compareBvhLayouts(const std::shared_ptr<const Scene>& scene, const RenderSettings& settings, std::ostream& out) const;
+
+    // Renders the scene with every thread placement at 1, 2, 4, ... up to settings.thread_count workers
+    // and reports the speedup over one worker, which shows how well each placement scales across sockets
+    void compareThreadPlacements(const std::shared_ptr<const Scene>& scene, const RenderSettings& settings, std::ostream& out) const;
+
+    // Renders the scene with the tiles in camera order, ordered by probed costs and ordered by the costs of
+    // the probed render, and compares the time of the passes with the ideal of the tile work spread evenly
+    void compareTileSchedules(const std::shared_ptr<const Scene>& scene, const RenderSettings& settings, std::ostream& out) const;
+};
+
+#endif //RAY_TRACER_BENCHMARK_H
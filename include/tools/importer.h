@@ -7,7 +7,14 @@
 
 class Importer {
 public:
+    // Threads used to parse large ascii meshes
+    explicit Importer(unsigned int threadCount = 1);
+
+    // A mesh may keep its faces in a PLY file, <Faces plyFile="path"/>, relative to the scene file
     Scene importXml(const std::string &filepath);
+
+private:
+    unsigned int thread_count;
 };
 
 #endif
@@ -0,0 +1,25 @@
+#ifndef RAY_TRACER_PLYREADER_H
+#define RAY_TRACER_PLYREADER_H
+
+#include <string>
+#include <vector>
+#include "../utilities.h"
+
+// Faces read from a file until they are turned into triangles
+using FaceBuffer = TrackedVector<Face, MemoryCategory::ParserBuffers>;
+
+// Reads triangle meshes from ascii and binary little endian PLY files. The file is memory mapped,
+// binary records are decoded straight from the mapping and ascii bodies are parsed in parallel chunks.
+class PlyReader {
+public:
+    explicit PlyReader(unsigned int threadCount = 1);
+
+    // Appends the vertices of the file to vertices and its faces, fan triangulated, to faces.
+    // Face indices are zero based positions in vertices.
+    void read(const std::string& path, VertexBuffer& vertices, FaceBuffer& faces) const;
+
+private:
+    unsigned int thread_count;
+};
+
+#endif //RAY_TRACER_PLYREADER_H
@@ -0,0 +1,48 @@
+#ifndef RAY_TRACER_REGRESSION_H
+#define RAY_TRACER_REGRESSION_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../core/raytracer.h"
+
+struct RegressionSettings {
+    // Scene files to render, the built-in corpus when empty
+    std::vector<std::string> scene_paths;
+    // Throughput of every scene and path and the thread count it was measured with. Written when it does not
+    // exist yet, checked against otherwise, which fails for another thread count.
+    std::string baseline_path;
+    // Rewrite the baseline with this run instead of checking against it
+    bool update_baseline = false;
+    // Largest difference of a color channel from the reference image a pixel may have
+    int pixel_tolerance = 0;
+    // Throughput below the baseline by more than this many percent fails the run
+    double max_slowdown_percent = 10;
+    // Renders per scene and path, the fastest one counts
+    int runs = 5;
+};
+
+// One way of rendering a scene, every path must give the pixels of the reference path
+struct RenderPath {
+    std::string name;
+    RenderSettings settings;
+    // Rendered with renderProgressive and no deadline rather than with render
+    bool progressive = false;
+};
+
+class RegressionHarness {
+public:
+    // Renders every scene with the reference path and every optimized path, compares the images with those of
+    // the reference and the throughput with the baseline. Returns false if any of them regressed.
+    bool run(const RegressionSettings& regression, const RenderSettings& settings, std::ostream& out) const;
+
+    // The reference comes first: every ray tests every object, tiles in scanline order and no probe. The grid
+    // and the binary BVH replace its structure, the other paths each add one optimization to the BVH.
+    static std::vector<RenderPath> renderPaths(const RenderSettings& settings);
+
+    // Writes scenes that use every object and face format of Importer::importXml into directory and returns
+    // the paths of their xml files. Meshes come inline, as ascii PLY with quads and as binary PLY.
+    static std::vector<std::string> writeCorpus(const std::string& directory);
+};
+
+#endif //RAY_TRACER_REGRESSION_H
@@ -5,6 +5,8 @@
 #include <cmath>
 #include <vector>
 #include <memory>
+#include "core/memoryTracker.h"
+#include "core/sceneArena.h"
 
 class RenderObject;
 
@@ -35,6 +37,15 @@ struct Vec3f
     mutable float cachedSqrLength;
 };
 
+struct BoundingBox
+{
+    Vec3f min, max;
+    BoundingBox();
+    BoundingBox(const Vec3f& min, const Vec3f& max);
+    void expand(const Vec3f& point);
+    void expand(const BoundingBox& other);
+};
+
 struct Color
 {
     int r, g, b;
@@ -87,6 +98,9 @@ struct Face
     int v2_id;
 };
 
+using VertexBuffer = TrackedVector<Vec3f, MemoryCategory::VertexData>;
+
+// Move only, render_objects point into the arena. Renderers share one through a std::shared_ptr<const Scene>.
 struct Scene
 {
     Color background_color;
@@ -96,7 +110,9 @@ struct Scene
     Vec3f ambient_light;
     std::vector<PointLight> point_lights;
     std::vector<Material> materials;
-    std::vector<Vec3f> vertex_data;
+    VertexBuffer vertex_data;
+    // Owns the objects of render_objects
+    SceneArena arena;
     std::vector<RenderObject*> render_objects;
 };
 
@@ -0,0 +1,120 @@
+#include "../../include/core/acceleration.h"
+#include "../../include/core/grid.h"
+#include "../../include/geometry/sphere.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+namespace {
+
+// Below this the choice hardly matters
+const size_t minimumGridPrimitives = 128;
+// Share of the primitives that must be spheres. A surface of triangles leaves most cells empty and crowds
+// the rest, which the grid traverses up to three times slower than the hierarchy even at uniform sizes.
+const float minimumSphereShare = 0.9f;
+// The middle 80% of the primitive sizes must lie within this factor of each other
+const float similarSizeRatio = 8.0f;
+// Spread of the primitives: binned by center into cells of about this many primitives, at least the given
+// share of the cells must hold one. Clustered spheres traverse twice as slowly in the grid.
+const float spreadPrimitivesPerCell = 8.0f;
+const float minimumOccupiedShare = 0.5f;
+
+}
+
+AccelerationKind chooseAcceleration(const std::vector<RenderObject*>& objects) {
+    size_t count = objects.size();
+    if (count < minimumGridPrimitives) {
+        return AccelerationKind::Bvh;
+    }
+
+    size_t sphereCount = 0;
+    for (RenderObject* object : objects) {
+        if (dynamic_cast<Sphere*>(object) != nullptr) {
+            sphereCount++;
+        }
+    }
+    if (sphereCount < minimumSphereShare * count) {
+        return AccelerationKind::Bvh;
+    }
+
+    // Mixing tiny and huge spheres leaves either the small ones crowded or the large ones in many cells
+    std::vector<float> sizes(count);
+    for (size_t i = 0; i < count; i++) {
+        BoundingBox bounds = objects[i]->getBounds();
+        Vec3f extent = bounds.max - bounds.min;
+        sizes[i] = std::max(extent.x, std::max(extent.y, extent.z));
+    }
+    std::nth_element(sizes.begin(), sizes.begin() + count / 10, sizes.end());
+    float small = sizes[count / 10];
+    std::nth_element(sizes.begin(), sizes.begin() + count * 9 / 10, sizes.end());
+    float large = sizes[count * 9 / 10];
+    if (!(small > 0.0f) || large > similarSizeRatio * small) {
+        return AccelerationKind::Bvh;
+    }
+
+    std::vector<Vec3f> centers(count);
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (size_t i = 0; i < count; i++) {
+        BoundingBox bounds = objects[i]->getBounds();
+        centers[i] = (bounds.min + bounds.max) * 0.5f;
+        const float center[3] = {centers[i].x, centers[i].y, centers[i].z};
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = std::min(min[axis], center[axis]);
+            max[axis] = std::max(max[axis], center[axis]);
+        }
+    }
+    int resolution[3];
+    gridResolution(min, max, count / spreadPrimitivesPerCell, 0.0f, resolution);
+    std::vector<bool> occupied((size_t)resolution[0] * resolution[1] * resolution[2], false);
+    size_t occupiedCount = 0;
+    for (const Vec3f& center : centers) {
+        const float position[3] = {center.x, center.y, center.z};
+        size_t cell = 0;
+        for (int axis = 2; axis >= 0; axis--) {
+            float extent = max[axis] - min[axis];
+            int coordinate = extent > 0.0f ? (int)((position[axis] - min[axis]) / extent * resolution[axis]) : 0;
+            cell = cell * resolution[axis] + std::min(coordinate, resolution[axis] - 1);
+        }
+        if (!occupied[cell]) {
+            occupied[cell] = true;
+            occupiedCount++;
+        }
+    }
+    if (occupiedCount < minimumOccupiedShare * occupied.size()) {
+        return AccelerationKind::Bvh;
+    }
+    return AccelerationKind::Grid;
+}
+
+const char* accelerationKindName(AccelerationKind kind) {
+    switch (kind) {
+        case AccelerationKind::Bvh:
+            return "bvh";
+        case AccelerationKind::Grid:
+            return "grid";
+        case AccelerationKind::Linear:
+            return "linear";
+        default:
+            return "auto";
+    }
+}
+
+bool parseAccelerationKind(const char* name, AccelerationKind& kind) {
+    if (strcmp(name, "auto") == 0) {
+        kind = AccelerationKind::Auto;
+    }
+    else if (strcmp(name, "bvh") == 0) {
+        kind = AccelerationKind::Bvh;
+    }
+    else if (strcmp(name, "grid") == 0) {
+        kind = AccelerationKind::Grid;
+    }
+    else if (strcmp(name, "linear") == 0) {
+        kind = AccelerationKind::Linear;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,949 @@
+#include "../../include/core/bvh.h"
+#include "../../include/core/renderStats.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+
+namespace {
+
+const int binCount = 16;
+const uint32_t maxLeafSize = 8;
+const float traversalCost = 1.0f;
+const float intersectionCost = 1.0f;
+
+// Nodes with more primitives than this are binned in chunks by all workers
+const uint32_t parallelBinningThreshold = 32 * 1024;
+const uint32_t chunkSize = 8 * 1024;
+
+// From this depth on splits always cut at the median, which keeps the tree within the traversal stack
+const int sahDepthLimit = 96;
+const int traversalStackSize = 128;
+
+const int compressedWidth = 8;
+const uint8_t emptyChild = 0xff;
+// Every level of the wide tree pushes at most all of its children
+const int compressedStackSize = compressedWidth * traversalStackSize;
+
+// Subtrees a frustum is culled to at most, every ray inside it tests all of their boxes
+const int maxFrustumEntries = 4;
+// Traversals of arbitrary rays start at the root alone
+const uint32_t rootEntry = 0;
+
+// Build buffers count towards the acceleration structure, they set its peak
+template <class T>
+using BuildVector = TrackedVector<T, MemoryCategory::Acceleration>;
+
+struct Box {
+    float min[3];
+    float max[3];
+
+    Box() {
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = FLT_MAX;
+            max[axis] = -FLT_MAX;
+        }
+    }
+
+    void expand(const float point[3]) {
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = std::min(min[axis], point[axis]);
+            max[axis] = std::max(max[axis], point[axis]);
+        }
+    }
+
+    void expand(const Box& other) {
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = std::min(min[axis], other.min[axis]);
+            max[axis] = std::max(max[axis], other.max[axis]);
+        }
+    }
+
+    float extent(int axis) const {
+        return max[axis] - min[axis];
+    }
+
+    float area() const {
+        if (min[0] > max[0]) {
+            return 0.0f;
+        }
+        float dx = extent(0), dy = extent(1), dz = extent(2);
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+};
+
+struct Point {
+    float v[3];
+};
+
+struct BuildTask {
+    uint32_t node;
+    uint32_t begin, end;
+    int depth;
+    Box bounds;
+    Box centroidBounds;
+};
+
+struct Bin {
+    Box bounds;
+    Box centroidBounds;
+    uint32_t count = 0;
+};
+
+struct Bins {
+    Bin bins[3][binCount];
+
+    void merge(const Bins& other) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int b = 0; b < binCount; b++) {
+                bins[axis][b].bounds.expand(other.bins[axis][b].bounds);
+                bins[axis][b].centroidBounds.expand(other.bins[axis][b].centroidBounds);
+                bins[axis][b].count += other.bins[axis][b].count;
+            }
+        }
+    }
+};
+
+// Either a leaf, or the two child tasks of an inner node
+struct Split {
+    bool isLeaf = true;
+    int axis = 0;
+    BuildTask left, right;
+};
+
+// Runs body(begin, end) over fixed size chunks of [begin, end) on the pool and waits for all of them
+template <class F>
+void parallelChunks(ThreadPool& threadPool, uint32_t begin, uint32_t end, F&& body) {
+    std::vector<std::future<void>> pending;
+    for (uint32_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize) {
+        uint32_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+        pending.push_back(threadPool.enqueue([&body, chunkBegin, chunkEnd]() { body(chunkBegin, chunkEnd); }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+}
+
+class BvhBuilder {
+public:
+    BvhBuilder(const BuildVector<Box>& primitiveBounds, const BuildVector<Point>& centroids, BuildVector<uint32_t>& indices)
+        : primitiveBounds(primitiveBounds), centroids(centroids), indices(indices) {}
+
+    void computeRange(BuildTask& task, uint32_t begin, uint32_t end) const {
+        for (uint32_t i = begin; i < end; i++) {
+            task.bounds.expand(primitiveBounds[indices[i]]);
+            task.centroidBounds.expand(centroids[indices[i]].v);
+        }
+    }
+
+    void computeRangeParallel(BuildTask& task, ThreadPool& threadPool) const {
+        std::vector<BuildTask> partial((task.end - task.begin + chunkSize - 1) / chunkSize);
+        parallelChunks(threadPool, task.begin, task.end, [&](uint32_t begin, uint32_t end) {
+            computeRange(partial[(begin - task.begin) / chunkSize], begin, end);
+        });
+        for (const BuildTask& chunk : partial) {
+            task.bounds.expand(chunk.bounds);
+            task.centroidBounds.expand(chunk.centroidBounds);
+        }
+    }
+
+    static int binIndex(const Box& centroidBounds, int axis, float centroid) {
+        float scale = binCount / centroidBounds.extent(axis);
+        int index = (int)((centroid - centroidBounds.min[axis]) * scale);
+        return std::min(std::max(index, 0), binCount - 1);
+    }
+
+    void binRange(const Box& centroidBounds, uint32_t begin, uint32_t end, Bins& result) const {
+        for (uint32_t i = begin; i < end; i++) {
+            const Point& centroid = centroids[indices[i]];
+            for (int axis = 0; axis < 3; axis++) {
+                if (centroidBounds.extent(axis) <= 0.0f) {
+                    continue;
+                }
+                Bin& bin = result.bins[axis][binIndex(centroidBounds, axis, centroid.v[axis])];
+                bin.bounds.expand(primitiveBounds[indices[i]]);
+                bin.centroidBounds.expand(centroid.v);
+                bin.count++;
+            }
+        }
+    }
+
+    Split split(const BuildTask& task) const {
+        if (task.end - task.begin <= 1 || task.depth >= sahDepthLimit) {
+            return splitMedian(task);
+        }
+        Bins bins;
+        binRange(task.centroidBounds, task.begin, task.end, bins);
+        return splitBinned(task, bins);
+    }
+
+    Split splitParallel(const BuildTask& task, ThreadPool& threadPool) const {
+        if (task.depth >= sahDepthLimit) {
+            return splitMedian(task);
+        }
+        std::vector<Bins> partial((task.end - task.begin + chunkSize - 1) / chunkSize);
+        parallelChunks(threadPool, task.begin, task.end, [&](uint32_t begin, uint32_t end) {
+            binRange(task.centroidBounds, begin, end, partial[(begin - task.begin) / chunkSize]);
+        });
+        for (size_t i = 1; i < partial.size(); i++) {
+            partial[0].merge(partial[i]);
+        }
+        return splitBinned(task, partial[0]);
+    }
+
+    // Builds the whole subtree of the task, whose node is the first entry of nodes
+    void buildSubtree(BuildVector<BvhNode>& nodes, const BuildTask& task) const {
+        Split result = split(task);
+        if (result.isLeaf) {
+            setNode(nodes, task, result);
+            return;
+        }
+        uint32_t firstChild = nodes.size();
+        nodes.emplace_back();
+        nodes.emplace_back();
+        result.left.node = firstChild;
+        result.right.node = firstChild + 1;
+        setNode(nodes, task, result);
+        buildSubtree(nodes, result.left);
+        buildSubtree(nodes, result.right);
+    }
+
+    // Writes the node of the task, children must already be assigned their node indices
+    static void setNode(BuildVector<BvhNode>& nodes, const BuildTask& task, const Split& result) {
+        BvhNode& node = nodes[task.node];
+        for (int axis = 0; axis < 3; axis++) {
+            // Padded so that hits computed with rounding errors on the box surface are not culled
+            node.bounds_min[axis] = task.bounds.min[axis] - 1e-5f * (std::fabs(task.bounds.min[axis]) + 1.0f);
+            node.bounds_max[axis] = task.bounds.max[axis] + 1e-5f * (std::fabs(task.bounds.max[axis]) + 1.0f);
+        }
+        if (result.isLeaf) {
+            node.offset = task.begin;
+            node.count = task.end - task.begin;
+            node.axis = 0;
+        }
+        else {
+            node.offset = result.left.node;
+            node.count = 0;
+            node.axis = result.axis;
+        }
+    }
+
+private:
+    Split makeChildren(const BuildTask& task, int axis, uint32_t mid) const {
+        Split result;
+        result.isLeaf = false;
+        result.axis = axis;
+        result.left.begin = task.begin;
+        result.left.end = mid;
+        result.right.begin = mid;
+        result.right.end = task.end;
+        result.left.depth = result.right.depth = task.depth + 1;
+        return result;
+    }
+
+    Split splitBinned(const BuildTask& task, const Bins& bins) const {
+        uint32_t count = task.end - task.begin;
+        float parentArea = task.bounds.area();
+        float inverseArea = parentArea > 0.0f ? 1.0f / parentArea : 1.0f;
+
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1, bestBin = 0;
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (task.centroidBounds.extent(axis) <= 0.0f) {
+                continue;
+            }
+
+            // Sweep from the right to get the area and count to the right of every bin boundary
+            float rightArea[binCount];
+            uint32_t rightCount[binCount];
+            Box accumulated;
+            uint32_t accumulatedCount = 0;
+            for (int b = binCount - 1; b > 0; b--) {
+                accumulated.expand(bins.bins[axis][b].bounds);
+                accumulatedCount += bins.bins[axis][b].count;
+                rightArea[b] = accumulated.area();
+                rightCount[b] = accumulatedCount;
+            }
+
+            accumulated = Box();
+            accumulatedCount = 0;
+            for (int b = 1; b < binCount; b++) {
+                accumulated.expand(bins.bins[axis][b - 1].bounds);
+                accumulatedCount += bins.bins[axis][b - 1].count;
+                if (accumulatedCount == 0 || rightCount[b] == 0) {
+                    continue;
+                }
+                float cost = traversalCost + intersectionCost * inverseArea *
+                        (accumulated.area() * accumulatedCount + rightArea[b] * rightCount[b]);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+
+        if (bestAxis < 0) {
+            // Every centroid is at the same point
+            return splitMedian(task);
+        }
+        if (bestCost >= intersectionCost * count && count <= maxLeafSize) {
+            return Split();
+        }
+
+        const Box& centroidBounds = task.centroidBounds;
+        uint32_t* middle = std::partition(indices.data() + task.begin, indices.data() + task.end, [&](uint32_t index) {
+            return binIndex(centroidBounds, bestAxis, centroids[index].v[bestAxis]) < bestBin;
+        });
+
+        Split result = makeChildren(task, bestAxis, middle - indices.data());
+        for (int b = 0; b < binCount; b++) {
+            BuildTask& child = b < bestBin ? result.left : result.right;
+            child.bounds.expand(bins.bins[bestAxis][b].bounds);
+            child.centroidBounds.expand(bins.bins[bestAxis][b].centroidBounds);
+        }
+        return result;
+    }
+
+    Split splitMedian(const BuildTask& task) const {
+        uint32_t count = task.end - task.begin;
+        if (count <= maxLeafSize) {
+            return Split();
+        }
+
+        int axis = 0;
+        for (int a = 1; a < 3; a++) {
+            if (task.centroidBounds.extent(a) > task.centroidBounds.extent(axis)) {
+                axis = a;
+            }
+        }
+
+        uint32_t mid = task.begin + count / 2;
+        std::nth_element(indices.data() + task.begin, indices.data() + mid, indices.data() + task.end,
+                         [&](uint32_t a, uint32_t b) { return centroids[a].v[axis] < centroids[b].v[axis]; });
+
+        Split result = makeChildren(task, axis, mid);
+        computeRange(result.left, result.left.begin, result.left.end);
+        computeRange(result.right, result.right.begin, result.right.end);
+        return result;
+    }
+
+    const BuildVector<Box>& primitiveBounds;
+    const BuildVector<Point>& centroids;
+    BuildVector<uint32_t>& indices;
+};
+
+inline bool intersectNode(const BvhNode& node, const float origin[3], const float inverseDirection[3], float tMax) {
+    float tNear = 0.0f;
+    float tFar = std::numeric_limits<float>::infinity();
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (node.bounds_min[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (node.bounds_max[axis] - origin[axis]) * inverseDirection[axis];
+        tNear = std::max(tNear, std::min(t0, t1));
+        tFar = std::min(tFar, std::max(t0, t1));
+    }
+    return tNear <= tFar && tNear <= tMax;
+}
+
+}
+
+Bvh::Bvh(BvhLayout layout) : layout(layout) {}
+
+void Bvh::build(const std::vector<RenderObject*>& renderObjects, ThreadPool& threadPool) {
+    auto buildStart = std::chrono::steady_clock::now();
+
+    objects = &renderObjects;
+    nodes.clear();
+    compressed_nodes.clear();
+    primitive_indices.clear();
+    stats = BvhStats();
+    stats.layout = layout;
+
+    uint32_t primitiveCount = renderObjects.size();
+    if (primitiveCount == 0) {
+        return;
+    }
+
+    BuildVector<Box> primitiveBounds(primitiveCount);
+    BuildVector<Point> centroids(primitiveCount);
+    primitive_indices.resize(primitiveCount);
+
+    parallelChunks(threadPool, 0, primitiveCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            BoundingBox bounds = renderObjects[i]->getBounds();
+            Box& box = primitiveBounds[i];
+            box.min[0] = bounds.min.x; box.min[1] = bounds.min.y; box.min[2] = bounds.min.z;
+            box.max[0] = bounds.max.x; box.max[1] = bounds.max.y; box.max[2] = bounds.max.z;
+            for (int axis = 0; axis < 3; axis++) {
+                centroids[i].v[axis] = 0.5f * (box.min[axis] + box.max[axis]);
+            }
+            primitive_indices[i] = i;
+        }
+    });
+
+    BvhBuilder builder(primitiveBounds, centroids, primitive_indices);
+
+    BuildTask root;
+    root.node = 0;
+    root.begin = 0;
+    root.end = primitiveCount;
+    root.depth = 0;
+    builder.computeRangeParallel(root, threadPool);
+    nodes.emplace_back();
+
+    // Top levels, breadth-first: big nodes are binned by every worker, the rest of a level are split one node per worker
+    std::vector<BuildTask> frontier{root};
+    size_t subtreeTarget = threadPool.size() * 4;
+    while (!frontier.empty() && frontier.size() < subtreeTarget) {
+        std::vector<Split> splits(frontier.size());
+        std::vector<std::future<void>> pending;
+
+        for (size_t i = 0; i < frontier.size(); i++) {
+            if (frontier[i].end - frontier[i].begin < parallelBinningThreshold) {
+                pending.push_back(threadPool.enqueue([&, i]() { splits[i] = builder.split(frontier[i]); }));
+            }
+        }
+        for (size_t i = 0; i < frontier.size(); i++) {
+            if (frontier[i].end - frontier[i].begin >= parallelBinningThreshold) {
+                splits[i] = builder.splitParallel(frontier[i], threadPool);
+            }
+        }
+        for (auto& task : pending) {
+            task.get();
+        }
+
+        std::vector<BuildTask> next;
+        for (size_t i = 0; i < frontier.size(); i++) {
+            Split& result = splits[i];
+            if (!result.isLeaf) {
+                result.left.node = nodes.size();
+                result.right.node = nodes.size() + 1;
+                nodes.emplace_back();
+                nodes.emplace_back();
+                next.push_back(result.left);
+                next.push_back(result.right);
+            }
+            BvhBuilder::setNode(nodes, frontier[i], result);
+        }
+        frontier.swap(next);
+    }
+
+    // The remaining subtrees are built by the workers into their own node lists, then appended
+    std::vector<BuildVector<BvhNode>> subtrees(frontier.size());
+    std::vector<std::future<void>> pending;
+    for (size_t i = 0; i < frontier.size(); i++) {
+        pending.push_back(threadPool.enqueue([&, i]() {
+            BuildTask task = frontier[i];
+            task.node = 0;
+            subtrees[i].emplace_back();
+            builder.buildSubtree(subtrees[i], task);
+        }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+
+    for (size_t i = 0; i < frontier.size(); i++) {
+        // Local node k > 0 becomes node base + k - 1, the local root replaces the frontier node
+        uint32_t base = nodes.size();
+        const BuildVector<BvhNode>& subtree = subtrees[i];
+        for (size_t k = 0; k < subtree.size(); k++) {
+            BvhNode node = subtree[k];
+            if (node.count == 0) {
+                node.offset = base + node.offset - 1;
+            }
+            if (k == 0) {
+                nodes[frontier[i].node] = node;
+            }
+            else {
+                nodes.push_back(node);
+            }
+        }
+    }
+
+    computeStats();
+    if (layout == BvhLayout::Compressed) {
+        collapse();
+    }
+    stats.build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+}
+
+void Bvh::computeStats() {
+    stats.primitive_count = primitive_indices.size();
+    stats.node_count = nodes.size();
+    stats.memory_bytes = nodes.size() * sizeof(BvhNode) + primitive_indices.size() * sizeof(uint32_t);
+
+    auto area = [](const BvhNode& node) {
+        float dx = node.bounds_max[0] - node.bounds_min[0];
+        float dy = node.bounds_max[1] - node.bounds_min[1];
+        float dz = node.bounds_max[2] - node.bounds_min[2];
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    };
+    float rootArea = area(nodes[0]);
+    float inverseRootArea = rootArea > 0.0f ? 1.0f / rootArea : 1.0f;
+
+    std::vector<std::pair<uint32_t, int>> stack{{0, 0}};
+    double sahCost = 0;
+    while (!stack.empty()) {
+        uint32_t nodeIndex = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        const BvhNode& node = nodes[nodeIndex];
+        stats.max_depth = std::max(stats.max_depth, depth);
+        if (node.count > 0) {
+            stats.leaf_count++;
+            sahCost += intersectionCost * node.count * area(node) * inverseRootArea;
+        }
+        else {
+            sahCost += traversalCost * area(node) * inverseRootArea;
+            stack.emplace_back(node.offset, depth + 1);
+            stack.emplace_back(node.offset + 1, depth + 1);
+        }
+    }
+    stats.sah_cost = sahCost;
+}
+
+RenderObject* Bvh::intersect(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const {
+    tMin = std::numeric_limits<float>::max();
+    if (layout == BvhLayout::Compressed) {
+        return intersectCompressed<false>(ray, tMin, ignoredObject, epsilon);
+    }
+    return intersectBinary<false>(ray, tMin, ignoredObject, epsilon, &rootEntry, 1);
+}
+
+RenderObject* Bvh::occluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, float epsilon) const {
+    if (layout == BvhLayout::Compressed) {
+        return intersectCompressed<true>(ray, maxDistance, ignoredObject, epsilon);
+    }
+    return intersectBinary<true>(ray, maxDistance, ignoredObject, epsilon, &rootEntry, 1);
+}
+
+bool Bvh::cullFrustum(const Frustum& frustum, std::vector<uint32_t>& entries) const {
+    // Wide nodes keep no box of their own, a ray entering one below the root would have to test all of its
+    // children in any order, which costs about what the skipped levels save
+    if (layout == BvhLayout::Compressed) {
+        return false;
+    }
+    entries.clear();
+    if (nodes.empty() || !frustum.overlaps(nodes[0].bounds_min, nodes[0].bounds_max)) {
+        return true;
+    }
+
+    // Breadth-first from the root, an inner node is replaced by its children in the frustum as long as the list
+    // stays short, since every entry costs every ray a box test. Inner nodes without such children drop out.
+    std::vector<uint32_t> pending(1, 0);
+    std::vector<uint32_t> decided;
+    for (size_t next = 0; next < pending.size(); next++) {
+        const BvhNode& node = nodes[pending[next]];
+        if (node.count > 0) {
+            decided.push_back(pending[next]);
+            continue;
+        }
+
+        uint32_t visible[2];
+        int count = 0;
+        for (uint32_t child = node.offset; child < node.offset + 2; child++) {
+            if (frustum.overlaps(nodes[child].bounds_min, nodes[child].bounds_max)) {
+                visible[count++] = child;
+            }
+        }
+        size_t listed = decided.size() + pending.size() - next - 1;
+        if (listed + count > (size_t)maxFrustumEntries) {
+            decided.push_back(pending[next]);
+        }
+        else {
+            pending.insert(pending.end(), visible, visible + count);
+        }
+    }
+
+    // Nearest first, rays that hit something there can skip the boxes behind it
+    std::vector<std::pair<float, uint32_t>> ordered;
+    for (uint32_t nodeIndex : decided) {
+        const BvhNode& node = nodes[nodeIndex];
+        float distance = 0.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            float outside = std::max(std::max(node.bounds_min[axis] - frustum.apex[axis], frustum.apex[axis] - node.bounds_max[axis]), 0.0f);
+            distance += outside * outside;
+        }
+        ordered.emplace_back(distance, nodeIndex);
+    }
+    std::stable_sort(ordered.begin(), ordered.end());
+    for (const auto& entry : ordered) {
+        entries.push_back(entry.second);
+    }
+    return true;
+}
+
+RenderObject* Bvh::intersectFrom(const std::vector<uint32_t>& entries, Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const {
+    tMin = std::numeric_limits<float>::max();
+    if (entries.empty()) {
+        return nullptr;
+    }
+    return intersectBinary<false>(ray, tMin, ignoredObject, epsilon, entries.data(), entries.size());
+}
+
+template <bool AnyHit>
+RenderObject* Bvh::intersectBinary(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon,
+                                   const uint32_t* entries, size_t entryCount) const {
+    RenderObject* hitObject = nullptr;
+    uint32_t hitIndex = 0;
+
+    if (nodes.empty()) {
+        return nullptr;
+    }
+
+    const float origin[3] = {ray->origin.x, ray->origin.y, ray->origin.z};
+    const float direction[3] = {ray->direction.x, ray->direction.y, ray->direction.z};
+    float inverseDirection[3];
+    bool directionNegative[3];
+    for (int axis = 0; axis < 3; axis++) {
+        inverseDirection[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : FLT_MAX;
+        directionNegative[axis] = direction[axis] < 0.0f;
+    }
+
+    const std::vector<RenderObject*>& renderObjects = *objects;
+    uint32_t stack[traversalStackSize + maxFrustumEntries];
+    int stackSize = 0;
+    for (size_t i = entryCount; i-- > 1;) {
+        stack[stackSize++] = entries[i];
+    }
+    uint32_t nodeIndex = entries[0];
+
+    while (true) {
+        const BvhNode& node = nodes[nodeIndex];
+        if (intersectNode(node, origin, inverseDirection, tMin)) {
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                    uint32_t objectIndex = primitive_indices[i];
+                    RenderObject* object = renderObjects[objectIndex];
+                    if (object == ignoredObject) {
+                        continue;
+                    }
+
+                    // Shadow rays take any blocker, closest hits break ties towards the object
+                    // that comes first in the scene, like a linear scan
+                    float t;
+                    if (AnyHit) {
+                        if (object->intersect(ray, t, epsilon) && t > 0.0f && t < tMin) {
+                            return object;
+                        }
+                    }
+                    else if (object->intersect(ray, t, epsilon) && (t < tMin || (t == tMin && objectIndex < hitIndex))) {
+                        tMin = t;
+                        hitObject = object;
+                        hitIndex = objectIndex;
+                    }
+                }
+            }
+            else {
+                uint32_t nearChild = node.offset + (directionNegative[node.axis] ? 1 : 0);
+                stack[stackSize++] = node.offset + (directionNegative[node.axis] ? 0 : 1);
+                nodeIndex = nearChild;
+                continue;
+            }
+        }
+
+        if (stackSize == 0) {
+            break;
+        }
+        nodeIndex = stack[--stackSize];
+    }
+
+    return hitObject;
+}
+
+void Bvh::collapse() {
+    BuildVector<uint32_t> compressedPrimitives;
+    compressedPrimitives.reserve(primitive_indices.size());
+    compressed_nodes.emplace_back();
+
+    auto area = [this](uint32_t nodeIndex) {
+        const BvhNode& node = nodes[nodeIndex];
+        float dx = node.bounds_max[0] - node.bounds_min[0];
+        float dy = node.bounds_max[1] - node.bounds_min[1];
+        float dz = node.bounds_max[2] - node.bounds_min[2];
+        return dx * dy + dy * dz + dz * dx;
+    };
+
+    // Primitive range of every subtree, children always come after their parent in the node array.
+    // Subtrees small enough for a leaf become a single leaf of the wide tree.
+    BuildVector<uint32_t> subtreeBegin(nodes.size()), subtreeCount(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const BvhNode& node = nodes[i];
+        if (node.count > 0) {
+            subtreeBegin[i] = node.offset;
+            subtreeCount[i] = node.count;
+        }
+        else {
+            subtreeBegin[i] = std::min(subtreeBegin[node.offset], subtreeBegin[node.offset + 1]);
+            subtreeCount[i] = subtreeCount[node.offset] + subtreeCount[node.offset + 1];
+        }
+    }
+    auto isLeaf = [&](uint32_t nodeIndex) {
+        return subtreeCount[nodeIndex] <= maxLeafSize;
+    };
+
+    // Breadth-first, so that the inner children of a wide node can be given consecutive indices
+    struct CollapseTask {
+        uint32_t wideNode;
+        uint32_t binaryNode;
+        int depth;
+    };
+    std::vector<CollapseTask> queue{{0, 0, 0}};
+    int maxDepth = 0;
+    size_t leafCount = 0;
+
+    for (size_t q = 0; q < queue.size(); q++) {
+        CollapseTask task = queue[q];
+        maxDepth = std::max(maxDepth, task.depth);
+
+        // Open the inner child with the largest surface area until the wide node is full
+        std::vector<uint32_t> children;
+        const BvhNode& binaryNode = nodes[task.binaryNode];
+        if (isLeaf(task.binaryNode)) {
+            children.push_back(task.binaryNode);
+        }
+        else {
+            children.push_back(binaryNode.offset);
+            children.push_back(binaryNode.offset + 1);
+        }
+        while (children.size() < compressedWidth) {
+            int opened = -1;
+            for (size_t i = 0; i < children.size(); i++) {
+                if (!isLeaf(children[i]) && (opened < 0 || area(children[i]) > area(children[opened]))) {
+                    opened = i;
+                }
+            }
+            if (opened < 0) {
+                break;
+            }
+            uint32_t firstChild = nodes[children[opened]].offset;
+            children[opened] = firstChild;
+            children.push_back(firstChild + 1);
+        }
+
+        CompressedBvhNode node;
+        Box bounds;
+        for (uint32_t child : children) {
+            bounds.expand(nodes[child].bounds_min);
+            bounds.expand(nodes[child].bounds_max);
+        }
+
+        float scale[3];
+        for (int axis = 0; axis < 3; axis++) {
+            // Smallest power of two that spans the node with 255 steps
+            float extent = bounds.extent(axis);
+            int exponent = extent > 0.0f ? (int)std::ceil(std::log2(extent / 255.0f)) : -126;
+            exponent = std::min(std::max(exponent, -126), 127);
+            if (exponent < 127 && bounds.min[axis] + 255.0f * std::ldexp(1.0f, exponent) < bounds.max[axis]) {
+                exponent++;
+            }
+            node.origin[axis] = bounds.min[axis];
+            node.exponent[axis] = exponent;
+            scale[axis] = std::ldexp(1.0f, exponent);
+        }
+        node.padding = 0;
+        node.first_child = compressed_nodes.size();
+        node.first_primitive = compressedPrimitives.size();
+
+        uint8_t innerCount = 0, primitiveCount = 0;
+        for (int slot = 0; slot < compressedWidth; slot++) {
+            if (slot >= (int)children.size()) {
+                for (int axis = 0; axis < 3; axis++) {
+                    node.quantized_min[axis][slot] = 0;
+                    node.quantized_max[axis][slot] = 0;
+                }
+                node.child_primitive_count[slot] = emptyChild;
+                node.child_offset[slot] = 0;
+                continue;
+            }
+
+            // Rounded outwards, so the decoded box always contains the child
+            const BvhNode& child = nodes[children[slot]];
+            for (int axis = 0; axis < 3; axis++) {
+                float low = std::floor((child.bounds_min[axis] - node.origin[axis]) / scale[axis]);
+                float high = std::ceil((child.bounds_max[axis] - node.origin[axis]) / scale[axis]);
+                node.quantized_min[axis][slot] = (uint8_t)std::min(std::max(low, 0.0f), 255.0f);
+                node.quantized_max[axis][slot] = (uint8_t)std::min(std::max(high, 0.0f), 255.0f);
+            }
+
+            if (isLeaf(children[slot])) {
+                uint32_t begin = subtreeBegin[children[slot]];
+                uint32_t count = subtreeCount[children[slot]];
+                node.child_primitive_count[slot] = count;
+                node.child_offset[slot] = primitiveCount;
+                compressedPrimitives.insert(compressedPrimitives.end(),
+                                            primitive_indices.begin() + begin,
+                                            primitive_indices.begin() + begin + count);
+                primitiveCount += count;
+                leafCount++;
+            }
+            else {
+                node.child_primitive_count[slot] = 0;
+                node.child_offset[slot] = innerCount++;
+                queue.push_back({(uint32_t)compressed_nodes.size(), children[slot], task.depth + 1});
+                compressed_nodes.emplace_back();
+            }
+        }
+
+        compressed_nodes[task.wideNode] = node;
+    }
+
+    // The binary tree is not needed for traversal anymore
+    primitive_indices.swap(compressedPrimitives);
+    BuildVector<BvhNode>().swap(nodes);
+    compressed_nodes.shrink_to_fit();
+
+    stats.node_count = compressed_nodes.size();
+    stats.leaf_count = leafCount;
+    stats.max_depth = maxDepth;
+    stats.memory_bytes = compressed_nodes.size() * sizeof(CompressedBvhNode) + primitive_indices.size() * sizeof(uint32_t);
+}
+
+template <bool AnyHit>
+RenderObject* Bvh::intersectCompressed(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const {
+    RenderObject* hitObject = nullptr;
+    uint32_t hitIndex = 0;
+
+    if (compressed_nodes.empty()) {
+        return nullptr;
+    }
+
+    const float origin[3] = {ray->origin.x, ray->origin.y, ray->origin.z};
+    const float direction[3] = {ray->direction.x, ray->direction.y, ray->direction.z};
+    float inverseDirection[3];
+    for (int axis = 0; axis < 3; axis++) {
+        inverseDirection[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : FLT_MAX;
+    }
+
+    const std::vector<RenderObject*>& renderObjects = *objects;
+    struct StackEntry {
+        uint32_t node;
+        float tNear;
+    };
+    StackEntry stack[compressedStackSize];
+    int stackSize = 0;
+    stack[stackSize++] = {0, 0.0f};
+
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (entry.tNear > tMin) {
+            continue;
+        }
+        const CompressedBvhNode& node = compressed_nodes[entry.node];
+
+        float scale[3];
+        for (int axis = 0; axis < 3; axis++) {
+            scale[axis] = std::ldexp(1.0f, node.exponent[axis]);
+        }
+
+        // Children hit by the ray, sorted by entry distance
+        int hitSlots[compressedWidth];
+        float hitDistances[compressedWidth];
+        int hitCount = 0;
+
+        for (int slot = 0; slot < compressedWidth; slot++) {
+            if (node.child_primitive_count[slot] == emptyChild) {
+                continue;
+            }
+            float tNear = 0.0f;
+            float tFar = std::numeric_limits<float>::infinity();
+            for (int axis = 0; axis < 3; axis++) {
+                // Child bound = origin + quantized * 2^exponent
+                float t0 = (node.origin[axis] + node.quantized_min[axis][slot] * scale[axis] - origin[axis]) * inverseDirection[axis];
+                float t1 = (node.origin[axis] + node.quantized_max[axis][slot] * scale[axis] - origin[axis]) * inverseDirection[axis];
+                tNear = std::max(tNear, std::min(t0, t1));
+                tFar = std::min(tFar, std::max(t0, t1));
+            }
+            if (tNear > tFar || tNear > tMin) {
+                continue;
+            }
+
+            int position = hitCount++;
+            while (position > 0 && hitDistances[position - 1] > tNear) {
+                hitSlots[position] = hitSlots[position - 1];
+                hitDistances[position] = hitDistances[position - 1];
+                position--;
+            }
+            hitSlots[position] = slot;
+            hitDistances[position] = tNear;
+        }
+
+        // Leaves are tested right away, nearest first, which tightens tMin for the inner children
+        for (int i = 0; i < hitCount; i++) {
+            int slot = hitSlots[i];
+            uint8_t count = node.child_primitive_count[slot];
+            if (count == 0 || hitDistances[i] > tMin) {
+                continue;
+            }
+            uint32_t first = node.first_primitive + node.child_offset[slot];
+            for (uint32_t p = first; p < first + count; p++) {
+                uint32_t objectIndex = primitive_indices[p];
+                RenderObject* object = renderObjects[objectIndex];
+                if (object == ignoredObject) {
+                    continue;
+                }
+
+                float t;
+                if (AnyHit) {
+                    if (object->intersect(ray, t, epsilon) && t > 0.0f && t < tMin) {
+                        return object;
+                    }
+                }
+                else if (object->intersect(ray, t, epsilon) && (t < tMin || (t == tMin && objectIndex < hitIndex))) {
+                    tMin = t;
+                    hitObject = object;
+                    hitIndex = objectIndex;
+                }
+            }
+        }
+
+        // Farthest inner child first, so the nearest one is popped next
+        for (int i = hitCount - 1; i >= 0; i--) {
+            int slot = hitSlots[i];
+            if (node.child_primitive_count[slot] == 0 && hitDistances[i] <= tMin) {
+                stack[stackSize++] = {node.first_child + node.child_offset[slot], hitDistances[i]};
+            }
+        }
+    }
+
+    return hitObject;
+}
+
+std::unique_ptr<AccelerationStructure> Bvh::cloneFor(const std::vector<RenderObject*>& renderObjects) const {
+    std::unique_ptr<Bvh> copy(new Bvh(*this));
+    copy->objects = &renderObjects;
+    return copy;
+}
+
+void Bvh::recordStats(RenderStats& renderStats) const {
+    renderStats.acceleration = AccelerationKind::Bvh;
+    renderStats.acceleration_build_seconds = stats.build_seconds;
+    renderStats.bvh = stats;
+}
+
+const BvhStats& Bvh::getStats() const {
+    return stats;
+}
+
+const char* bvhLayoutName(BvhLayout layout) {
+    return layout == BvhLayout::Compressed ? "compressed" : "binary";
+}
+
+bool parseBvhLayout(const char* name, BvhLayout& layout) {
+    if (strcmp(name, "binary") == 0) {
+        layout = BvhLayout::Binary;
+    }
+    else if (strcmp(name, "compressed") == 0) {
+        layout = BvhLayout::Compressed;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#include "../../include/core/frustum.h"
+
+bool Frustum::overlaps(const float min[3], const float max[3]) const {
+    for (int plane = 0; plane < 4; plane++) {
+        // The box corner farthest along the normal, if even that one is outside the whole box is
+        float distance = offset[plane];
+        for (int axis = 0; axis < 3; axis++) {
+            distance += normal[plane][axis] * (normal[plane][axis] >= 0.0f ? max[axis] : min[axis]);
+        }
+        if (distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Frustum tileFrustum(const Camera& camera, int startX, int endX, int startY, int endY) {
+    // Same image plane points as RayTracer::calculateSubpixelRay
+    auto imagePoint = [&camera](float x, float y) {
+        return camera.q + camera.u * (x * camera.pixel_width) - camera.v * (y * camera.pixel_height);
+    };
+    float left = startX - 1.0f, right = endX + 1.0f;
+    float top = startY - 1.0f, bottom = endY + 1.0f;
+    const Vec3f corners[4] = {imagePoint(left, top), imagePoint(right, top), imagePoint(right, bottom), imagePoint(left, bottom)};
+    Vec3f center = imagePoint((left + right) * 0.5f, (top + bottom) * 0.5f) - camera.position;
+
+    Frustum frustum;
+    frustum.apex[0] = camera.position.x;
+    frustum.apex[1] = camera.position.y;
+    frustum.apex[2] = camera.position.z;
+    for (int plane = 0; plane < 4; plane++) {
+        Vec3f normal = (corners[plane] - camera.position).cross(corners[(plane + 1) % 4] - camera.position);
+        // The winding depends on the handedness of the camera basis, the center ray decides the side
+        if (normal.dot(center) < 0.0f) {
+            normal = normal * -1.0f;
+        }
+        frustum.normal[plane][0] = normal.x;
+        frustum.normal[plane][1] = normal.y;
+        frustum.normal[plane][2] = normal.z;
+        frustum.offset[plane] = -normal.dot(camera.position);
+    }
+    return frustum;
+}
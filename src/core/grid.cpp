@@ -0,0 +1,400 @@
+#include "../../include/core/grid.h"
+#include "../../include/core/renderStats.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+
+namespace {
+
+// Top cells per primitive, and cells per primitive of a sub-grid
+const float topDensity = 0.5f;
+const float subgridDensity = 2.0f;
+// Top cells listing more primitives than this get a sub-grid
+const uint32_t subgridThreshold = 16;
+const int maxResolution = 1024;
+// Slots of the per ray record of the primitives tested last, indexed by the low bits of the primitive
+const uint32_t mailboxSize = 16;
+
+const uint32_t chunkSize = 8 * 1024;
+
+template <class T>
+using BuildVector = TrackedVector<T, MemoryCategory::Acceleration>;
+
+struct Box {
+    float min[3];
+    float max[3];
+};
+
+void initLevel(GridLevel& level, const float min[3], const float max[3], const int resolution[3], uint32_t firstCell) {
+    for (int axis = 0; axis < 3; axis++) {
+        level.bounds_min[axis] = min[axis];
+        level.bounds_max[axis] = max[axis];
+        level.resolution[axis] = resolution[axis];
+        level.cell_size[axis] = (max[axis] - min[axis]) / resolution[axis];
+        if (!(level.cell_size[axis] > 0.0f)) {
+            level.cell_size[axis] = 1.0f;
+        }
+        level.inverse_cell_size[axis] = 1.0f / level.cell_size[axis];
+    }
+    level.first_cell = firstCell;
+}
+
+uint32_t cellCount(const GridLevel& level) {
+    return (uint32_t)level.resolution[0] * level.resolution[1] * level.resolution[2];
+}
+
+int cellCoordinate(const GridLevel& level, int axis, float position) {
+    float cell = std::floor((position - level.bounds_min[axis]) * level.inverse_cell_size[axis]);
+    cell = std::min(std::max(cell, 0.0f), (float)(level.resolution[axis] - 1));
+    return (int)cell;
+}
+
+// Calls visit(cell) for every cell of the level the box overlaps
+template <class F>
+void forEachCell(const GridLevel& level, const Box& box, F&& visit) {
+    int first[3], last[3];
+    for (int axis = 0; axis < 3; axis++) {
+        first[axis] = cellCoordinate(level, axis, box.min[axis]);
+        last[axis] = cellCoordinate(level, axis, box.max[axis]);
+    }
+    for (int z = first[2]; z <= last[2]; z++) {
+        for (int y = first[1]; y <= last[1]; y++) {
+            uint32_t row = level.first_cell + ((uint32_t)z * level.resolution[1] + y) * level.resolution[0];
+            for (int x = first[0]; x <= last[0]; x++) {
+                visit(row + x);
+            }
+        }
+    }
+}
+
+bool clipToLevel(const GridLevel& level, const float origin[3], const float inverseDirection[3], float& tStart, float& tEnd) {
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (level.bounds_min[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (level.bounds_max[axis] - origin[axis]) * inverseDirection[axis];
+        tStart = std::max(tStart, std::min(t0, t1));
+        tEnd = std::min(tEnd, std::max(t0, t1));
+    }
+    return tStart <= tEnd;
+}
+
+// 3D-DDA over the cells of a level the ray crosses between tStart and tEnd, in order. Calls
+// visit(cell, tEnter, tExit) for each of them and stops early, returning true, once it returns true.
+template <class F>
+bool walkLevel(const GridLevel& level, const float origin[3], const float direction[3], const float inverseDirection[3],
+               float tStart, float tEnd, F&& visit) {
+    int cell[3], step[3];
+    float tNext[3], tDelta[3];
+    for (int axis = 0; axis < 3; axis++) {
+        cell[axis] = cellCoordinate(level, axis, origin[axis] + direction[axis] * tStart);
+        if (direction[axis] > 0.0f) {
+            step[axis] = 1;
+            tNext[axis] = (level.bounds_min[axis] + (cell[axis] + 1) * level.cell_size[axis] - origin[axis]) * inverseDirection[axis];
+            tDelta[axis] = level.cell_size[axis] * inverseDirection[axis];
+        }
+        else if (direction[axis] < 0.0f) {
+            step[axis] = -1;
+            tNext[axis] = (level.bounds_min[axis] + cell[axis] * level.cell_size[axis] - origin[axis]) * inverseDirection[axis];
+            tDelta[axis] = -level.cell_size[axis] * inverseDirection[axis];
+        }
+        else {
+            step[axis] = 0;
+            tNext[axis] = std::numeric_limits<float>::infinity();
+            tDelta[axis] = std::numeric_limits<float>::infinity();
+        }
+    }
+
+    float t = tStart;
+    while (true) {
+        int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        float tExit = std::min(tNext[axis], tEnd);
+        uint32_t index = level.first_cell + ((uint32_t)cell[2] * level.resolution[1] + cell[1]) * level.resolution[0] + cell[0];
+        if (visit(index, t, tExit)) {
+            return true;
+        }
+        if (tNext[axis] >= tEnd) {
+            return false;
+        }
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= level.resolution[axis]) {
+            return false;
+        }
+        t = tNext[axis];
+        tNext[axis] += tDelta[axis];
+    }
+}
+
+}
+
+void gridResolution(const float min[3], const float max[3], float cells, float minimumSide, int resolution[3]) {
+    float extent[3];
+    float largest = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        extent[axis] = max[axis] - min[axis];
+        largest = std::max(largest, extent[axis]);
+    }
+    if (!(largest > 0.0f)) {
+        resolution[0] = resolution[1] = resolution[2] = 1;
+        return;
+    }
+
+    // Flat boxes still get some thickness, so that the cells stay roughly cubic
+    for (int axis = 0; axis < 3; axis++) {
+        extent[axis] = std::max(extent[axis], largest * 1e-3f);
+    }
+    float side = std::max(std::cbrt(extent[0] * extent[1] * extent[2] / std::max(cells, 1.0f)), minimumSide);
+    for (int axis = 0; axis < 3; axis++) {
+        resolution[axis] = (int)std::min(std::max(std::ceil(extent[axis] / side), 1.0f), (float)maxResolution);
+    }
+}
+
+void Grid::build(const std::vector<RenderObject*>& renderObjects, ThreadPool& threadPool) {
+    auto buildStart = std::chrono::steady_clock::now();
+
+    objects = &renderObjects;
+    levels.clear();
+    cell_start.clear();
+    cell_primitives.clear();
+    subgrid.clear();
+    stats = GridStats();
+
+    uint32_t primitiveCount = renderObjects.size();
+    if (primitiveCount == 0) {
+        return;
+    }
+
+    BuildVector<Box> boxes(primitiveCount);
+    std::vector<std::future<void>> pending;
+    for (uint32_t chunkBegin = 0; chunkBegin < primitiveCount; chunkBegin += chunkSize) {
+        uint32_t chunkEnd = std::min(primitiveCount, chunkBegin + chunkSize);
+        pending.push_back(threadPool.enqueue([&, chunkBegin, chunkEnd]() {
+            for (uint32_t i = chunkBegin; i < chunkEnd; i++) {
+                BoundingBox bounds = renderObjects[i]->getBounds();
+                const float min[3] = {bounds.min.x, bounds.min.y, bounds.min.z};
+                const float max[3] = {bounds.max.x, bounds.max.y, bounds.max.z};
+                for (int axis = 0; axis < 3; axis++) {
+                    // Padded like the BVH nodes, hits on the box surface must not fall between cells
+                    boxes[i].min[axis] = min[axis] - 1e-5f * (std::fabs(min[axis]) + 1.0f);
+                    boxes[i].max[axis] = max[axis] + 1e-5f * (std::fabs(max[axis]) + 1.0f);
+                }
+            }
+        }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+
+    Box sceneBox = boxes[0];
+    BuildVector<float> sizes(primitiveCount);
+    for (uint32_t i = 0; i < primitiveCount; i++) {
+        const Box& box = boxes[i];
+        sizes[i] = 0.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            sceneBox.min[axis] = std::min(sceneBox.min[axis], box.min[axis]);
+            sceneBox.max[axis] = std::max(sceneBox.max[axis], box.max[axis]);
+            sizes[i] = std::max(sizes[i], box.max[axis] - box.min[axis]);
+        }
+    }
+    std::nth_element(sizes.begin(), sizes.begin() + primitiveCount / 2, sizes.end());
+    float medianSize = sizes[primitiveCount / 2];
+    BuildVector<float>().swap(sizes);
+
+    GridLevel top;
+    int resolution[3];
+    gridResolution(sceneBox.min, sceneBox.max, topDensity * primitiveCount, medianSize, resolution);
+    initLevel(top, sceneBox.min, sceneBox.max, resolution, 0);
+    levels.push_back(top);
+    uint32_t topCells = cellCount(top);
+
+    // Primitive lists of the top cells, counted first and then filled
+    BuildVector<uint32_t> topStart(topCells + 1, 0);
+    for (const Box& box : boxes) {
+        forEachCell(top, box, [&](uint32_t cell) { topStart[cell + 1]++; });
+    }
+    for (uint32_t cell = 0; cell < topCells; cell++) {
+        topStart[cell + 1] += topStart[cell];
+    }
+    BuildVector<uint32_t> topPrimitives(topStart[topCells]);
+    {
+        BuildVector<uint32_t> cursor(topStart.begin(), topStart.end() - 1);
+        for (uint32_t i = 0; i < primitiveCount; i++) {
+            forEachCell(top, boxes[i], [&](uint32_t cell) { topPrimitives[cursor[cell]++] = i; });
+        }
+    }
+
+    // Crowded top cells get a level of their own, whose cells are numbered after the top cells
+    subgrid.assign(topCells, 0);
+    std::vector<uint32_t> subgridCell;
+    uint32_t totalCells = topCells;
+    for (uint32_t cell = 0; cell < topCells; cell++) {
+        uint32_t count = topStart[cell + 1] - topStart[cell];
+        if (count <= subgridThreshold) {
+            continue;
+        }
+        int coordinate[3] = {(int)(cell % top.resolution[0]), (int)(cell / top.resolution[0] % top.resolution[1]),
+                             (int)(cell / top.resolution[0] / top.resolution[1])};
+        float min[3], max[3];
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = top.bounds_min[axis] + coordinate[axis] * top.cell_size[axis];
+            max[axis] = coordinate[axis] + 1 == top.resolution[axis] ? top.bounds_max[axis] : min[axis] + top.cell_size[axis];
+        }
+
+        gridResolution(min, max, subgridDensity * count, medianSize, resolution);
+        if (resolution[0] * resolution[1] * resolution[2] == 1) {
+            continue;
+        }
+        GridLevel level;
+        initLevel(level, min, max, resolution, totalCells);
+        totalCells += cellCount(level);
+        subgrid[cell] = levels.size();
+        subgridCell.push_back(cell);
+        levels.push_back(level);
+    }
+
+    // Final lists: the top cells without a sub-grid keep theirs, the sub-grids bin the primitives of their cell.
+    // Every sub-grid owns a separate range of cells, so they are binned in parallel.
+    cell_start.assign(totalCells + 1, 0);
+    for (uint32_t cell = 0; cell < topCells; cell++) {
+        if (subgrid[cell] == 0) {
+            cell_start[cell + 1] = topStart[cell + 1] - topStart[cell];
+        }
+    }
+    auto forEachSubgrid = [&](auto&& body) {
+        std::vector<std::future<void>> tasks;
+        for (size_t s = 0; s < subgridCell.size(); s++) {
+            tasks.push_back(threadPool.enqueue([&, s]() {
+                uint32_t cell = subgridCell[s];
+                const GridLevel& level = levels[subgrid[cell]];
+                for (uint32_t i = topStart[cell]; i < topStart[cell + 1]; i++) {
+                    uint32_t primitive = topPrimitives[i];
+                    forEachCell(level, boxes[primitive], [&](uint32_t subCell) { body(subCell, primitive); });
+                }
+            }));
+        }
+        for (auto& task : tasks) {
+            task.get();
+        }
+    };
+    forEachSubgrid([&](uint32_t cell, uint32_t) { cell_start[cell + 1]++; });
+    for (uint32_t cell = 0; cell < totalCells; cell++) {
+        cell_start[cell + 1] += cell_start[cell];
+    }
+
+    cell_primitives.resize(cell_start[totalCells]);
+    for (uint32_t cell = 0; cell < topCells; cell++) {
+        if (subgrid[cell] == 0) {
+            std::copy(topPrimitives.begin() + topStart[cell], topPrimitives.begin() + topStart[cell + 1],
+                      cell_primitives.begin() + cell_start[cell]);
+        }
+    }
+    {
+        BuildVector<uint32_t> cursor(cell_start.begin(), cell_start.end() - 1);
+        forEachSubgrid([&](uint32_t cell, uint32_t primitive) { cell_primitives[cursor[cell]++] = primitive; });
+    }
+
+    stats.primitive_count = primitiveCount;
+    for (int axis = 0; axis < 3; axis++) {
+        stats.resolution[axis] = top.resolution[axis];
+    }
+    stats.cell_count = totalCells;
+    stats.subgrid_count = subgridCell.size();
+    stats.references_per_primitive = (float)cell_primitives.size() / primitiveCount;
+    stats.memory_bytes = levels.size() * sizeof(GridLevel) + cell_start.size() * sizeof(uint32_t) +
+                         cell_primitives.size() * sizeof(uint32_t) + subgrid.size() * sizeof(uint32_t);
+    stats.build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+}
+
+RenderObject* Grid::intersect(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const {
+    tMin = std::numeric_limits<float>::max();
+    return traverse<false>(ray, tMin, ignoredObject, epsilon);
+}
+
+RenderObject* Grid::occluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, float epsilon) const {
+    return traverse<true>(ray, maxDistance, ignoredObject, epsilon);
+}
+
+template <bool AnyHit>
+RenderObject* Grid::traverse(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const {
+    if (levels.empty()) {
+        return nullptr;
+    }
+
+    const float origin[3] = {ray->origin.x, ray->origin.y, ray->origin.z};
+    const float direction[3] = {ray->direction.x, ray->direction.y, ray->direction.z};
+    float inverseDirection[3];
+    for (int axis = 0; axis < 3; axis++) {
+        inverseDirection[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : FLT_MAX;
+    }
+
+    float tStart = 0.0f;
+    float tEnd = tMin;
+    if (!clipToLevel(levels[0], origin, inverseDirection, tStart, tEnd)) {
+        return nullptr;
+    }
+
+    const std::vector<RenderObject*>& renderObjects = *objects;
+    RenderObject* hitObject = nullptr;
+    uint32_t hitIndex = 0;
+
+    // Primitives spanning several cells are listed in each of them. A primitive still in its mailbox slot
+    // was already tested with this ray, and testing it again would give the same result.
+    uint32_t mailbox[mailboxSize];
+    std::fill(mailbox, mailbox + mailboxSize, std::numeric_limits<uint32_t>::max());
+
+    auto visitCell = [&](uint32_t cell, float, float tExit) {
+        for (uint32_t i = cell_start[cell]; i < cell_start[cell + 1]; i++) {
+            uint32_t objectIndex = cell_primitives[i];
+            uint32_t& slot = mailbox[objectIndex % mailboxSize];
+            if (slot == objectIndex) {
+                continue;
+            }
+            slot = objectIndex;
+            RenderObject* object = renderObjects[objectIndex];
+            if (object == ignoredObject) {
+                continue;
+            }
+
+            float t;
+            if (AnyHit) {
+                if (object->intersect(ray, t, epsilon) && t > 0.0f && t < tMin) {
+                    hitObject = object;
+                    return true;
+                }
+            }
+            else if (object->intersect(ray, t, epsilon) && (t < tMin || (t == tMin && objectIndex < hitIndex))) {
+                tMin = t;
+                hitObject = object;
+                hitIndex = objectIndex;
+            }
+        }
+        // Nothing in the cells further along the ray can be closer than a hit inside this one
+        return !AnyHit && hitObject != nullptr && tMin <= tExit;
+    };
+
+    walkLevel(levels[0], origin, direction, inverseDirection, tStart, tEnd, [&](uint32_t cell, float tEnter, float tExit) {
+        if (subgrid[cell] == 0) {
+            return visitCell(cell, tEnter, tExit);
+        }
+        return walkLevel(levels[subgrid[cell]], origin, direction, inverseDirection, tEnter, tExit, visitCell);
+    });
+
+    return hitObject;
+}
+
+std::unique_ptr<AccelerationStructure> Grid::cloneFor(const std::vector<RenderObject*>& renderObjects) const {
+    std::unique_ptr<Grid> copy(new Grid(*this));
+    copy->objects = &renderObjects;
+    return copy;
+}
+
+void Grid::recordStats(RenderStats& renderStats) const {
+    renderStats.acceleration = AccelerationKind::Grid;
+    renderStats.acceleration_build_seconds = stats.build_seconds;
+    renderStats.grid = stats;
+}
+
+const GridStats& Grid::getStats() const {
+    return stats;
+}
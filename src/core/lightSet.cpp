@@ -0,0 +1,104 @@
+#include "../../include/core/lightSet.h"
+#include <cstring>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+// One float per light of a batch, mapped to a single SSE register on x86
+typedef float Lanes __attribute__((vector_size(sizeof(float) * LightBatch::width)));
+
+inline Lanes load(const std::vector<float>& values, size_t first) {
+    Lanes lanes;
+    std::memcpy(&lanes, values.data() + first, sizeof(Lanes));
+    return lanes;
+}
+
+inline void store(const Lanes& lanes, float* values) {
+    std::memcpy(values, &lanes, sizeof(Lanes));
+}
+
+inline Lanes squareRoot(Lanes x) {
+#ifdef __SSE__
+    return (Lanes)_mm_sqrt_ps((__m128)x);
+#else
+    for (int i = 0; i < LightBatch::width; i++) {
+        x[i] = std::sqrt(x[i]);
+    }
+    return x;
+#endif
+}
+
+// Also maps NaN to zero, like std::max(0.0f, x)
+inline Lanes positivePart(Lanes x) {
+    Lanes zero = {};
+    return x > zero ? x : zero;
+}
+
+}
+
+void LightSet::assign(const std::vector<PointLight>& lights) {
+    count = lights.size();
+    size_t padded = (count + LightBatch::width - 1) / LightBatch::width * LightBatch::width;
+
+    for (std::vector<float>* values : {&position_x, &position_y, &position_z, &intensity_x, &intensity_y, &intensity_z}) {
+        values->assign(padded, 0.0f);
+    }
+    for (size_t i = 0; i < count; i++) {
+        position_x[i] = lights[i].position.x;
+        position_y[i] = lights[i].position.y;
+        position_z[i] = lights[i].position.z;
+        intensity_x[i] = lights[i].intensity.x;
+        intensity_y[i] = lights[i].intensity.y;
+        intensity_z[i] = lights[i].intensity.z;
+    }
+}
+
+size_t LightSet::size() const {
+    return count;
+}
+
+size_t LightSet::paddedSize() const {
+    return position_x.size();
+}
+
+void LightSet::shade(size_t first, const ShadingPoint& point, LightBatch& batch) const {
+    Lanes zero = {};
+
+    Lanes dx = load(position_x, first) - point.position.x;
+    Lanes dy = load(position_y, first) - point.position.y;
+    Lanes dz = load(position_z, first) - point.position.z;
+    Lanes distance = squareRoot(dx * dx + dy * dy + dz * dz);
+    Lanes lx = dx / distance;
+    Lanes ly = dy / distance;
+    Lanes lz = dz / distance;
+
+    // Inverse square falloff, a light at the surface point gives nothing
+    Lanes distanceSquared = distance * distance;
+    Lanes irradianceX = distanceSquared != zero ? load(intensity_x, first) / distanceSquared : zero;
+    Lanes irradianceY = distanceSquared != zero ? load(intensity_y, first) / distanceSquared : zero;
+    Lanes irradianceZ = distanceSquared != zero ? load(intensity_z, first) / distanceSquared : zero;
+
+    Lanes cosTheta = positivePart(lx * point.normal.x + ly * point.normal.y + lz * point.normal.z);
+
+    Lanes hx = lx + point.to_viewer.x;
+    Lanes hy = ly + point.to_viewer.y;
+    Lanes hz = lz + point.to_viewer.z;
+    Lanes halfLength = squareRoot(hx * hx + hy * hy + hz * hz);
+    Lanes cosAlpha = positivePart((hx * point.normal.x + hy * point.normal.y + hz * point.normal.z) / halfLength);
+
+    Lanes highlight;
+    for (int i = 0; i < LightBatch::width; i++) {
+        highlight[i] = std::pow(cosAlpha[i], point.phong_exponent);
+    }
+
+    store(lx, batch.direction_x);
+    store(ly, batch.direction_y);
+    store(lz, batch.direction_z);
+    store(distance, batch.distance);
+    store((point.diffuse.x * cosTheta + point.specular.x * highlight) * irradianceX, batch.red);
+    store((point.diffuse.y * cosTheta + point.specular.y * highlight) * irradianceY, batch.green);
+    store((point.diffuse.z * cosTheta + point.specular.z * highlight) * irradianceZ, batch.blue);
+}
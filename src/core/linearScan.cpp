@@ -0,0 +1,42 @@
+#include "../../include/core/linearScan.h"
+#include "../../include/core/renderStats.h"
+#include <limits>
+
+void LinearScan::build(const std::vector<RenderObject*>& renderObjects, ThreadPool&) {
+    objects = &renderObjects;
+}
+
+RenderObject* LinearScan::intersect(Ray* ray, float& tMin, RenderObject* ignoredObject, float epsilon) const {
+    tMin = std::numeric_limits<float>::max();
+    RenderObject* hitObject = nullptr;
+    // Ties go to the object that comes first
+    for (RenderObject* object : *objects) {
+        float t;
+        if (object != ignoredObject && object->intersect(ray, t, epsilon) && t < tMin) {
+            tMin = t;
+            hitObject = object;
+        }
+    }
+    return hitObject;
+}
+
+RenderObject* LinearScan::occluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, float epsilon) const {
+    for (RenderObject* object : *objects) {
+        float t;
+        if (object != ignoredObject && object->intersect(ray, t, epsilon) && t > 0.0f && t < maxDistance) {
+            return object;
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<AccelerationStructure> LinearScan::cloneFor(const std::vector<RenderObject*>& renderObjects) const {
+    std::unique_ptr<LinearScan> copy(new LinearScan(*this));
+    copy->objects = &renderObjects;
+    return copy;
+}
+
+void LinearScan::recordStats(RenderStats& renderStats) const {
+    renderStats.acceleration = AccelerationKind::Linear;
+    renderStats.acceleration_build_seconds = 0;
+}
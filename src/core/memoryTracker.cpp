@@ -0,0 +1,96 @@
+#include "../../include/core/memoryTracker.h"
+#include <atomic>
+#include <iomanip>
+
+namespace {
+
+struct Counter {
+    std::atomic<size_t> current{0};
+    std::atomic<size_t> peak{0};
+
+    void add(size_t bytes) {
+        size_t now = current.fetch_add(bytes) + bytes;
+        size_t previous = peak.load();
+        while (now > previous && !peak.compare_exchange_weak(previous, now)) {
+        }
+    }
+
+    MemoryUsage read() const {
+        MemoryUsage usage;
+        usage.current_bytes = current.load();
+        usage.peak_bytes = peak.load();
+        return usage;
+    }
+};
+
+const size_t categoryCount = (size_t)MemoryCategory::Count;
+
+// Function statics, so allocations made while other globals are constructed are counted too
+Counter* counters() {
+    static Counter counters[categoryCount + 1];
+    return counters;
+}
+
+Counter& totalCounter() {
+    return counters()[categoryCount];
+}
+
+}
+
+void MemoryTracker::allocated(MemoryCategory category, size_t bytes) {
+    counters()[(size_t)category].add(bytes);
+    totalCounter().add(bytes);
+}
+
+void MemoryTracker::released(MemoryCategory category, size_t bytes) {
+    counters()[(size_t)category].current -= bytes;
+    totalCounter().current -= bytes;
+}
+
+MemoryUsage MemoryTracker::usage(MemoryCategory category) {
+    return counters()[(size_t)category].read();
+}
+
+MemoryUsage MemoryTracker::total() {
+    return totalCounter().read();
+}
+
+void MemoryTracker::print(std::ostream& out) {
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(2);
+
+    auto printRow = [&out](const char* name, const MemoryUsage& usage) {
+        out << "  " << std::left << std::setw(16) << name << std::right
+            << std::setw(12) << usage.current_bytes / (1024.0 * 1024.0)
+            << std::setw(12) << usage.peak_bytes / (1024.0 * 1024.0) << std::endl;
+    };
+
+    out << "Memory usage" << std::endl;
+    out << "  " << std::left << std::setw(16) << "category" << std::right
+        << std::setw(12) << "MiB now" << std::setw(12) << "MiB peak" << std::endl;
+    for (size_t i = 0; i < categoryCount; i++) {
+        MemoryCategory category = (MemoryCategory)i;
+        printRow(memoryCategoryName(category), usage(category));
+    }
+    printRow("total", total());
+
+    out.flags(flags);
+}
+
+const char* memoryCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::VertexData:
+            return "vertex data";
+        case MemoryCategory::Primitives:
+            return "primitives";
+        case MemoryCategory::Acceleration:
+            return "acceleration";
+        case MemoryCategory::Framebuffers:
+            return "framebuffers";
+        case MemoryCategory::ParserBuffers:
+            return "parser buffers";
+        case MemoryCategory::Count:
+            break;
+    }
+    return "unknown";
+}
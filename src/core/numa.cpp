@@ -0,0 +1,147 @@
+#include "../../include/core/numa.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// Parses a kernel CPU or node list such as "0-3,8,10-11"
+static std::vector<int> parseList(const std::string& list) {
+    std::vector<int> values;
+    std::stringstream stream(list);
+    std::string range;
+
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int value = first; value <= last; value++) {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+static bool readFile(const std::string& path, std::string& content) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::getline(file, content);
+    return true;
+}
+
+static bool isAllowed(int cpu) {
+#ifdef __linux__
+    static cpu_set_t allowed;
+    static bool known = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    return !known || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed));
+#else
+    return true;
+#endif
+}
+
+NumaTopology NumaTopology::detect() {
+    NumaTopology topology;
+    std::string online;
+
+    if (readFile("/sys/devices/system/node/online", online)) {
+        for (int node : parseList(online)) {
+            std::string cpuList;
+            if (!readFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpuList)) {
+                continue;
+            }
+
+            std::vector<int> cpus;
+            for (int cpu : parseList(cpuList)) {
+                if (isAllowed(cpu)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty()) {
+                topology.node_cpus.push_back(cpus);
+            }
+        }
+    }
+
+    if (topology.node_cpus.empty()) {
+        // One node of every CPU in the affinity mask, which need not include the first hardware_concurrency
+        // CPUs, e.g. under taskset -c 8-11. Every CPU without a mask.
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            unsigned int cpuCount = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned int cpu = 0; cpu < cpuCount; cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+        topology.node_cpus.push_back(cpus);
+    }
+
+    return topology;
+}
+
+std::vector<WorkerPlacement> placeWorkers(const NumaTopology& topology, ThreadPlacement placement, size_t threadCount) {
+    std::vector<WorkerPlacement> placements(threadCount);
+    if (placement == ThreadPlacement::None) {
+        return placements;
+    }
+
+    // Round robin over the nodes, so a pool smaller than the machine still uses every socket
+    size_t nodeCount = topology.node_cpus.size();
+    for (size_t i = 0; i < threadCount; i++) {
+        size_t node = i % nodeCount;
+        const std::vector<int>& cpus = topology.node_cpus[node];
+
+        placements[i].group = node;
+        if (placement == ThreadPlacement::Cores) {
+            placements[i].cpus.push_back(cpus[(i / nodeCount) % cpus.size()]);
+        }
+        else {
+            placements[i].cpus = cpus;
+        }
+    }
+    return placements;
+}
+
+const char* threadPlacementName(ThreadPlacement placement) {
+    switch (placement) {
+        case ThreadPlacement::Cores:
+            return "cores";
+        case ThreadPlacement::NumaNodes:
+            return "numa";
+        default:
+            return "none";
+    }
+}
+
+bool parseThreadPlacement(const char* name, ThreadPlacement& placement) {
+    if (strcmp(name, "none") == 0) {
+        placement = ThreadPlacement::None;
+    }
+    else if (strcmp(name, "cores") == 0) {
+        placement = ThreadPlacement::Cores;
+    }
+    else if (strcmp(name, "numa") == 0) {
+        placement = ThreadPlacement::NumaNodes;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#include "../../include/core/perfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+static int openCacheCounter(uint64_t cache, uint64_t result) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+CacheCounters::CacheCounters() {
+    fds[0] = openCacheCounter(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+    fds[1] = openCacheCounter(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS);
+    fds[2] = openCacheCounter(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+    fds[3] = openCacheCounter(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS);
+}
+
+CacheCounters::~CacheCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+CacheCounterValues CacheCounters::read() const {
+    CacheCounterValues values;
+    uint64_t counts[counterCount];
+
+    for (int i = 0; i < counterCount; i++) {
+        if (fds[i] < 0 || ::read(fds[i], &counts[i], sizeof(uint64_t)) != sizeof(uint64_t)) {
+            return values;
+        }
+    }
+
+    values.available = true;
+    values.l1_accesses = counts[0];
+    values.l1_misses = counts[1];
+    values.llc_accesses = counts[2];
+    values.llc_misses = counts[3];
+    return values;
+}
+
+#else
+
+CacheCounters::CacheCounters() {
+    for (int& fd : fds) {
+        fd = -1;
+    }
+}
+
+CacheCounters::~CacheCounters() = default;
+
+CacheCounterValues CacheCounters::read() const {
+    return CacheCounterValues();
+}
+
+#endif
@@ -0,0 +1,439 @@
+#include "../../include/core/rasterizer.h"
+#include "../../include/core/raytracer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+
+namespace {
+
+// Rows rasterized by one task
+const int bandHeight = 16;
+// Columns of the blocks of a band whose farthest decided depth hides the objects behind it
+const int blockWidth = 8;
+const size_t projectionChunkSize = 4096;
+// Pixels whose center lies within this barycentric distance of a triangle edge are left to the ray, whose
+// intersection test may round the other way
+const double edgeMargin = 1e-4;
+// Surfaces of a pixel closer together than this relative depth are left to the ray
+const double depthMargin = 1e-4;
+
+// Inclusive pixel rectangle, empty when minX > maxX
+struct ScreenBounds {
+    int minX, maxX;
+    int minY, maxY;
+};
+
+struct ProjectedObject {
+    ScreenBounds bounds;
+    // No part of the object is closer to the eye
+    double nearest_depth;
+};
+
+// Position in the camera basis, a and b across the image and z the depth in front of the eye
+struct ViewPoint {
+    double a, b, z;
+};
+
+// Pixel coordinates, pixel (x, y) is centered on (x, y), and the reciprocal depth, which is linear on the screen
+struct ScreenPoint {
+    double x, y, inverse_z;
+};
+
+// A triangle clipped to the space in front of the eye and projected, a convex polygon of up to four corners
+struct ScreenPolygon {
+    ScreenPoint corners[4];
+    int count = 0;
+    // A clipped part comes close enough to the eye to be seen anywhere on the screen
+    bool near_clipped = false;
+};
+
+class Projector {
+public:
+    explicit Projector(const Camera& camera) : camera(camera) {
+        // Coordinates of a direction in the (u, v, w) basis, which is not necessarily orthogonal
+        float determinant = camera.u.dot(camera.v.cross(camera.w));
+        uAxis = camera.v.cross(camera.w) / determinant;
+        vAxis = camera.w.cross(camera.u) / determinant;
+        wAxis = camera.u.cross(camera.v) / determinant;
+
+        nearZ = 1e-3 * camera.near_distance;
+        // Distance from the eye of the farthest visible point at depth one
+        double slopeX = std::max(std::abs(camera.near_plane.x), std::abs(camera.near_plane.y)) / camera.near_distance;
+        double slopeY = std::max(std::abs(camera.near_plane.z), std::abs(camera.near_plane.w)) / camera.near_distance;
+        rayStretch = std::sqrt(1 + slopeX * slopeX + slopeY * slopeY);
+    }
+
+    ViewPoint toView(const Vec3f& point) const {
+        Vec3f d = point - camera.position;
+        return {d.dot(uAxis), d.dot(vAxis), -d.dot(wAxis)};
+    }
+
+    // Camera rays pass through q + u * (x + 0.5) * pixel_width - v * (y + 0.5) * pixel_height
+    ScreenPoint toScreen(const ViewPoint& point) const {
+        double scale = camera.near_distance / point.z;
+        return {(point.a * scale - camera.near_plane.x) / camera.pixel_width - 0.5,
+                (camera.near_plane.w - point.b * scale) / camera.pixel_height - 0.5,
+                1.0 / point.z};
+    }
+
+    // Depth in front of the eye of the point at t along a camera ray
+    double depth(const Ray& ray, float t) const {
+        return -(double)t * ray.direction.dot(wAxis);
+    }
+
+    ScreenBounds whole() const {
+        return {0, camera.image_width - 1, 0, camera.image_height - 1};
+    }
+
+    // Pixels around the points, with one pixel of slack against rounding
+    ScreenBounds bounds(const ScreenPoint* points, int count) const {
+        double minX = std::numeric_limits<double>::max(), maxX = -minX;
+        double minY = minX, maxY = -minX;
+        for (int i = 0; i < count; i++) {
+            minX = std::min(minX, points[i].x);
+            maxX = std::max(maxX, points[i].x);
+            minY = std::min(minY, points[i].y);
+            maxY = std::max(maxY, points[i].y);
+        }
+        ScreenBounds screen = whole();
+        ScreenBounds bounds;
+        bounds.minX = (int)std::max((double)screen.minX, std::floor(minX) - 1);
+        bounds.maxX = (int)std::min((double)screen.maxX, std::ceil(maxX) + 1);
+        bounds.minY = (int)std::max((double)screen.minY, std::floor(minY) - 1);
+        bounds.maxY = (int)std::min((double)screen.maxY, std::ceil(maxY) + 1);
+        return bounds;
+    }
+
+    ScreenPolygon project(const Triangle& triangle) const {
+        ViewPoint view[3] = {toView(triangle.vertex_0), toView(triangle.vertex_1), toView(triangle.vertex_2)};
+        ViewPoint clipped[4];
+        int count = 0;
+        bool clippedAny = false;
+        for (int i = 0; i < 3; i++) {
+            const ViewPoint& current = view[i];
+            const ViewPoint& next = view[(i + 1) % 3];
+            bool currentInside = current.z >= nearZ;
+            if (currentInside) {
+                clipped[count++] = current;
+            }
+            if (currentInside != (next.z >= nearZ)) {
+                double s = (nearZ - current.z) / (next.z - current.z);
+                clipped[count++] = {current.a + s * (next.a - current.a), current.b + s * (next.b - current.b), nearZ};
+            }
+            clippedAny = clippedAny || !currentInside;
+        }
+
+        ScreenPolygon polygon;
+        polygon.count = count;
+        for (int i = 0; i < count; i++) {
+            polygon.corners[i] = toScreen(clipped[i]);
+        }
+        // The part behind nearZ is visible only if the triangle passes within nearZ * rayStretch of the eye
+        if (clippedAny) {
+            float planeDistance = std::abs(triangle.normal.dot(camera.position - triangle.vertex_0));
+            polygon.near_clipped = planeDistance < nearZ * rayStretch;
+        }
+        return polygon;
+    }
+
+    // Pixels the object may cover, every pixel when it reaches behind nearZ
+    ProjectedObject project(RenderObject* object) const {
+        if (auto* triangle = dynamic_cast<Triangle*>(object)) {
+            ScreenPolygon polygon = project(*triangle);
+            if (polygon.near_clipped) {
+                return {whole(), 0.0};
+            }
+            if (polygon.count == 0) {
+                return {{0, -1, 0, -1}, 0.0};
+            }
+            double farthestInverse = 0;
+            for (int i = 0; i < polygon.count; i++) {
+                farthestInverse = std::max(farthestInverse, polygon.corners[i].inverse_z);
+            }
+            return {bounds(polygon.corners, polygon.count), 1.0 / farthestInverse};
+        }
+
+        // The projected corners of the bounding box enclose the projection of anything inside it
+        BoundingBox box = object->getBounds();
+        ScreenPoint corners[8];
+        double nearest = std::numeric_limits<double>::max();
+        for (int i = 0; i < 8; i++) {
+            ViewPoint corner = toView(Vec3f(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z));
+            if (corner.z < nearZ) {
+                return {whole(), 0.0};
+            }
+            corners[i] = toScreen(corner);
+            nearest = std::min(nearest, corner.z);
+        }
+        return {bounds(corners, 8), nearest};
+    }
+
+private:
+    const Camera& camera;
+    Vec3f uAxis, vAxis, wAxis;
+    double nearZ;
+    double rayStretch;
+};
+
+// What the raster knows about one pixel
+struct PixelFragments {
+    int object_id = -1;
+    double depth = std::numeric_limits<double>::max();
+    // Closest other surface the raster is sure of, and closest one it is not sure covers the pixel
+    double second_depth = std::numeric_limits<double>::max();
+    double uncertain_depth = std::numeric_limits<double>::max();
+
+    void cover(int objectId, double fragmentDepth) {
+        if (fragmentDepth < depth) {
+            second_depth = depth;
+            depth = fragmentDepth;
+            object_id = objectId;
+        }
+        else {
+            second_depth = std::min(second_depth, fragmentDepth);
+        }
+    }
+
+    void mayCover(double fragmentDepth) {
+        uncertain_depth = std::min(uncertain_depth, fragmentDepth);
+    }
+
+    // Surfaces beyond this depth cannot change the pixel
+    double limit() const {
+        return depth == std::numeric_limits<double>::max() ? depth : depth + depthMargin * std::abs(depth);
+    }
+
+    // The winner is certain when nothing else lies within the depth margin in front of or just behind it
+    bool decided() const {
+        return uncertain_depth > limit() && second_depth > limit();
+    }
+};
+
+double edge(const ScreenPoint& a, const ScreenPoint& b, double x, double y) {
+    return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+// Scans the triangle a, b, c inside the pixels of area, fragments holds the rows of the band from bandStart on
+void rasterizeTriangle(const ScreenPoint& a, const ScreenPoint& b, const ScreenPoint& c, int objectId, const ScreenBounds& area,
+                       int bandStart, int width, std::vector<PixelFragments>& fragments) {
+    ScreenPoint corners[3] = {a, b, c};
+    double doubleArea = edge(a, b, c.x, c.y);
+    int minX = (int)std::max((double)area.minX, std::floor(std::min({a.x, b.x, c.x})) - 1);
+    int maxX = (int)std::min((double)area.maxX, std::ceil(std::max({a.x, b.x, c.x})) + 1);
+    int minY = (int)std::max((double)area.minY, std::floor(std::min({a.y, b.y, c.y})) - 1);
+    int maxY = (int)std::min((double)area.maxY, std::ceil(std::max({a.y, b.y, c.y})) + 1);
+
+    // Seen edge on, the ray test may hit it anywhere along its line
+    if (std::abs(doubleArea) < 1e-9) {
+        double nearest = 1.0 / std::max({a.inverse_z, b.inverse_z, c.inverse_z});
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                fragments[(y - bandStart) * width + x].mayCover(nearest);
+            }
+        }
+        return;
+    }
+
+    for (int y = minY; y <= maxY; y++) {
+        for (int x = minX; x <= maxX; x++) {
+            // Barycentric coordinates of the pixel center
+            double weight[3];
+            for (int i = 0; i < 3; i++) {
+                weight[i] = edge(corners[(i + 1) % 3], corners[(i + 2) % 3], x, y) / doubleArea;
+            }
+            double inside = std::min({weight[0], weight[1], weight[2]});
+            if (inside < -edgeMargin) {
+                continue;
+            }
+            double depth = 1.0 / (weight[0] * a.inverse_z + weight[1] * b.inverse_z + weight[2] * c.inverse_z);
+            PixelFragments& pixel = fragments[(y - bandStart) * width + x];
+            if (inside < edgeMargin) {
+                pixel.mayCover(depth);
+            }
+            else {
+                pixel.cover(objectId, depth);
+            }
+        }
+    }
+}
+
+}
+
+VisibilityBuffer::VisibilityBuffer(int width, int height)
+    : width(width), height(height), samples(width * height, VisibilitySample{-1, std::numeric_limits<float>::max()}) {}
+
+VisibilitySample& VisibilityBuffer::at(int x, int y) {
+    return samples[y * width + x];
+}
+
+const VisibilitySample& VisibilityBuffer::at(int x, int y) const {
+    return samples[y * width + x];
+}
+
+uint64_t Rasterizer::rasterize(const Scene& scene, const Camera& camera, ThreadPool& threadPool, VisibilityBuffer& buffer) const {
+    const std::vector<RenderObject*>& objects = scene.render_objects;
+    Projector projector(camera);
+
+    std::vector<ProjectedObject> projected(objects.size());
+    std::vector<std::future<void>> pending;
+    for (size_t begin = 0; begin < objects.size(); begin += projectionChunkSize) {
+        size_t end = std::min(objects.size(), begin + projectionChunkSize);
+        pending.push_back(threadPool.enqueue([&, begin, end]() {
+            for (size_t i = begin; i < end; i++) {
+                projected[i] = projector.project(objects[i]);
+            }
+        }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+    pending.clear();
+
+    // Near objects first, they hide the ones behind them
+    std::vector<int> order(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&projected](int a, int b) {
+        return projected[a].nearest_depth < projected[b].nearest_depth;
+    });
+
+    // Objects overlapping each band of rows, from near to far
+    int bandCount = (camera.image_height + bandHeight - 1) / bandHeight;
+    std::vector<std::vector<int>> bandObjects(bandCount);
+    for (int i : order) {
+        const ScreenBounds& bounds = projected[i].bounds;
+        if (bounds.minX > bounds.maxX || bounds.minY > bounds.maxY) {
+            continue;
+        }
+        for (int band = bounds.minY / bandHeight; band <= bounds.maxY / bandHeight; band++) {
+            bandObjects[band].push_back(i);
+        }
+    }
+
+    std::atomic<uint64_t> unresolvedPixels(0);
+    for (int band = 0; band < bandCount; band++) {
+        pending.push_back(threadPool.enqueue([&, band]() {
+            int bandStart = band * bandHeight;
+            int bandEnd = std::min(camera.image_height, bandStart + bandHeight) - 1;
+            int width = camera.image_width;
+            std::vector<PixelFragments> fragments((bandEnd - bandStart + 1) * width);
+
+            // Farthest limit of the pixels of every block, recomputed when an object may have changed it
+            int blockCount = (width + blockWidth - 1) / blockWidth;
+            std::vector<double> blockLimit(blockCount, std::numeric_limits<double>::max());
+            std::vector<bool> blockChanged(blockCount, false);
+            auto hidden = [&](const ScreenBounds& bounds, double nearestDepth) {
+                for (int block = bounds.minX / blockWidth; block <= bounds.maxX / blockWidth; block++) {
+                    if (blockChanged[block]) {
+                        double limit = 0;
+                        for (int y = bandStart; y <= bandEnd; y++) {
+                            for (int x = block * blockWidth; x < std::min(width, (block + 1) * blockWidth); x++) {
+                                limit = std::max(limit, fragments[(y - bandStart) * width + x].limit());
+                            }
+                        }
+                        blockLimit[block] = limit;
+                        blockChanged[block] = false;
+                    }
+                    if (nearestDepth <= blockLimit[block]) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            for (int objectId : bandObjects[band]) {
+                const ScreenBounds& bounds = projected[objectId].bounds;
+                if (hidden(bounds, projected[objectId].nearest_depth)) {
+                    continue;
+                }
+                for (int block = bounds.minX / blockWidth; block <= bounds.maxX / blockWidth; block++) {
+                    blockChanged[block] = true;
+                }
+
+                RenderObject* object = objects[objectId];
+                int firstRow = std::max(bounds.minY, bandStart);
+                int lastRow = std::min(bounds.maxY, bandEnd);
+
+                if (auto* triangle = dynamic_cast<Triangle*>(object)) {
+                    ScreenPolygon polygon = projector.project(*triangle);
+                    if (polygon.near_clipped) {
+                        for (int y = firstRow; y <= lastRow; y++) {
+                            for (int x = bounds.minX; x <= bounds.maxX; x++) {
+                                fragments[(y - bandStart) * width + x].mayCover(0);
+                            }
+                        }
+                        continue;
+                    }
+                    // Fan of the clipped polygon. The inner diagonal of a clipped triangle counts as an edge,
+                    // which only leaves a few more pixels to the ray.
+                    ScreenBounds area = {bounds.minX, bounds.maxX, firstRow, lastRow};
+                    for (int i = 1; i + 1 < polygon.count; i++) {
+                        rasterizeTriangle(polygon.corners[0], polygon.corners[i], polygon.corners[i + 1], objectId,
+                                          area, bandStart, width, fragments);
+                    }
+                    continue;
+                }
+
+                // Other objects are intersected exactly, but only inside their projected bounds
+                for (int y = firstRow; y <= lastRow; y++) {
+                    for (int x = bounds.minX; x <= bounds.maxX; x++) {
+                        Ray ray = RayTracer::calculateRayFromCamera(camera, x, y);
+                        float t;
+                        if (object->intersect(&ray, t, scene.shadow_ray_epsilon)) {
+                            fragments[(y - bandStart) * width + x].cover(objectId, projector.depth(ray, t));
+                        }
+                    }
+                }
+            }
+
+            // The camera ray of each decided pixel is intersected with its winner alone, for the exact depth
+            uint64_t unresolved = 0;
+            for (int y = bandStart; y <= bandEnd; y++) {
+                for (int x = 0; x < width; x++) {
+                    const PixelFragments& pixel = fragments[(y - bandStart) * width + x];
+                    VisibilitySample& sample = buffer.at(x, y);
+                    if (pixel.object_id < 0 && pixel.uncertain_depth == std::numeric_limits<double>::max()) {
+                        continue;
+                    }
+
+                    Ray ray = RayTracer::calculateRayFromCamera(camera, x, y);
+                    float t;
+                    if (pixel.object_id >= 0 && pixel.decided() && objects[pixel.object_id]->intersect(&ray, t, scene.shadow_ray_epsilon)) {
+                        sample.object_id = pixel.object_id;
+                        sample.depth = t;
+                    }
+                    else {
+                        sample.object_id = unresolvedObject;
+                        unresolved++;
+                    }
+                }
+            }
+            unresolvedPixels += unresolved;
+        }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+    return unresolvedPixels;
+}
+
+const char* primaryVisibilityName(PrimaryVisibility visibility) {
+    return visibility == PrimaryVisibility::Rasterized ? "raster" : "raytrace";
+}
+
+bool parsePrimaryVisibility(const char* name, PrimaryVisibility& visibility) {
+    if (strcmp(name, "raytrace") == 0) {
+        visibility = PrimaryVisibility::RayTraced;
+    }
+    else if (strcmp(name, "raster") == 0) {
+        visibility = PrimaryVisibility::Rasterized;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
@@ -2,86 +2,467 @@
 #include <limits>
 #include <cstring>
 #include <functional>
+#include <chrono>
+#include <future>
+
+// Rays cast by the current worker, flushed into rayCount once per tile
+static thread_local uint64_t tileRayCount = 0;
+// Shadow rays of the current worker, how many were blocked and how many of those the occluder cache
+// answered, flushed the same way
+static thread_local uint64_t tileShadowRayCount = 0;
+static thread_local uint64_t tileBlockedShadowRays = 0;
+static thread_local uint64_t tileOccluderHits = 0;
+
+// Last object that blocked each light for the current worker. Neighbouring pixels are mostly shadowed by
+// the same object, so it is tested before searching the whole scene.
+static thread_local std::vector<RenderObject*> shadowOccluders;
+static thread_local const AccelerationStructure* shadowOccludersScene = nullptr;
+
+// Geometry and acceleration structure the current worker traces against, its node's replica if there is one
+static thread_local const AccelerationStructure* workerAcceleration = nullptr;
+static thread_local const std::vector<RenderObject*>* workerObjects = nullptr;
+
+// Parts of the acceleration structure the camera rays of the current tile can reach, when tileCulled is set
+static thread_local std::vector<uint32_t> tileEntries;
+static thread_local bool tileCulled = false;
+
+// A tile of one of the cameras and the time it and its whole camera are expected to take
+struct ScheduledTile {
+    size_t camera;
+    size_t tile;
+    float cost;
+    float camera_cost;
+};
+
+RayTracer::RayTracer(const RenderSettings& renderSettings) : settings(renderSettings), rayCount(0), shadowRayCount(0), blockedShadowRays(0), occluderHits(0), culledTiles(0), tileEntryCount(0) {
+    if (settings.thread_count == 0) {
+        settings.thread_count = 1;
+    }
+
+    int tileSize = 1;
+    while (tileSize < settings.tile_size) {
+        tileSize *= 2;
+    }
+    settings.tile_size = tileSize;
+}
+
+const RenderStats& RayTracer::getStats() const {
+    return stats;
+}
 
 RenderObject* RayTracer::raycast(Ray* ray, float& tMin, RenderObject* ignoredObject) {
-	RenderObject* hitObject = nullptr;
+	tileRayCount++;
+	if (ray->depth == 0 && tileCulled) {
+		return workerAcceleration->intersectFrom(tileEntries, ray, tMin, ignoredObject, scene->shadow_ray_epsilon);
+	}
+	return workerAcceleration->intersect(ray, tMin, ignoredObject, scene->shadow_ray_epsilon);
+}
+
+bool RayTracer::isOccluded(Ray* ray, float maxDistance, RenderObject* ignoredObject, size_t lightIndex) {
+	tileRayCount++;
+	tileShadowRayCount++;
+
+	RenderObject*& occluder = shadowOccluders[lightIndex];
+	float t;
+	if (occluder != nullptr && occluder != ignoredObject &&
+	    occluder->intersect(ray, t, scene->shadow_ray_epsilon) && t > 0.0f && t < maxDistance) {
+		tileBlockedShadowRays++;
+		tileOccluderHits++;
+		return true;
+	}
+
+	RenderObject* blocker = workerAcceleration->occluded(ray, maxDistance, ignoredObject, scene->shadow_ray_epsilon);
+	if (blocker != nullptr) {
+		tileBlockedShadowRays++;
+		occluder = blocker;
+	}
+	return blocker != nullptr;
+}
+
+void RayTracer::bindWorkerScene() {
+    if (replicas.empty()) {
+        workerAcceleration = acceleration.get();
+        workerObjects = &scene->render_objects;
+    }
+    else {
+        const SceneReplica& replica = *replicas[ThreadPool::currentGroup()];
+        workerAcceleration = replica.acceleration.get();
+        workerObjects = &replica.objects;
+    }
+
+    // Cached occluders belong to the geometry they were found in
+    if (shadowOccludersScene != workerAcceleration || shadowOccluders.size() != lights.size()) {
+        shadowOccluders.assign(lights.size(), nullptr);
+        shadowOccludersScene = workerAcceleration;
+    }
+}
 
-	tMin = std::numeric_limits<float>::max();
+void RayTracer::renderPartial(const Camera& camera, RenderResult* result, const Tile& tile, const VisibilityBuffer* visibility, const RenderPass& pass) {
+    // Pixels are visited in z-order inside the tile so that consecutive rays stay close on screen. The walk
+    // covers the power of two square around the clipped tile, not a tile larger than the image.
+    uint32_t side = 1;
+    while (side < (uint32_t)std::max(tile.endX - tile.startX, tile.endY - tile.startY)) {
+        side *= 2;
+    }
+    uint32_t pixelsInTile = side * side;
+    tileRayCount = 0;
+    tileShadowRayCount = 0;
+    tileBlockedShadowRays = 0;
+    tileOccluderHits = 0;
+    bindWorkerScene();
+
+    // Camera rays only need the part of the scene inside the tile's frustum, which is found once for all of them
+    tileCulled = settings.tile_culling && visibility == nullptr &&
+                 workerAcceleration->cullFrustum(tileFrustum(camera, tile.startX, tile.endX, tile.startY, tile.endY), tileEntries);
+    if (tileCulled) {
+        culledTiles++;
+        tileEntryCount += tileEntries.size();
+    }
 
-	//Trace render objects
-	float tRenderObject;
-	size_t renderObjectCount = scene.render_objects.size();
+    for (uint32_t i = 0; i < pixelsInTile; i++) {
+        uint32_t dx, dy;
+        decodeMorton(i, dx, dy);
 
-	for (int i = 0; i < renderObjectCount; i++) {
-        if (scene.render_objects[i] == ignoredObject){
+        int x = tile.startX + (int)dx;
+        int y = tile.startY + (int)dy;
+        if (x >= tile.endX || y >= tile.endY || dx % pass.pixel_step != 0 || dy % pass.pixel_step != 0) {
             continue;
         }
 
-		if (scene.render_objects[i]->intersect(ray, tRenderObject, scene.shadow_ray_epsilon) && tRenderObject < tMin) {
-			tMin = tRenderObject;
-			hitObject = scene.render_objects[i];
-		}
-	}
+        Vec3f computedColor = computePixelColor(camera, x, y, visibility, pass.sample_grid);
+
+        // A coarse sample stands for the whole block of pixels up to the next one
+        for (int blockY = y; blockY < std::min(y + pass.pixel_step, tile.endY); blockY++) {
+            for (int blockX = x; blockX < std::min(x + pass.pixel_step, tile.endX); blockX++) {
+                result->setPixel(blockX, blockY, computedColor.x, computedColor.y, computedColor.z);
+            }
+        }
+    }
 
-	return hitObject;
+    rayCount += tileRayCount;
+    shadowRayCount += tileShadowRayCount;
+    blockedShadowRays += tileBlockedShadowRays;
+    occluderHits += tileOccluderHits;
 }
 
-void RayTracer::renderPartial(const Scene& scene, Camera camera, RenderResult* result, int startX, int endX, int startY, int endY) {
-    for (int y = startY; y < endY; y++) {
-        for (int x = startX; x < endX; x++) {
-            Ray rayFromCamera = calculateRayFromCamera(camera, x, y);
+Vec3f RayTracer::computePixelColor(const Camera& camera, int x, int y, const VisibilityBuffer* visibility, int sampleGrid) {
+    if (sampleGrid <= 1) {
+        Ray rayFromCamera = calculateRayFromCamera(camera, x, y);
+        rayFromCamera.depth = 0;
+
+        Vec3f computedColor;
+        // Pixels the rasterizer could not decide are traced like without it
+        if (visibility != nullptr && rayFromCamera.depth <= recursionLimit && visibility->at(x, y).object_id != unresolvedObject) {
+            const VisibilitySample& sample = visibility->at(x, y);
+            RenderObject* hitObject = sample.object_id >= 0 ? (*workerObjects)[sample.object_id] : nullptr;
+            computedColor = shadeHit(&rayFromCamera, hitObject, sample.depth);
+        }
+        else {
+            computedColor = computeColor(&rayFromCamera, nullptr);
+        }
+        return clamp(computedColor);
+    }
+
+    // Stratified sampleGrid x sampleGrid rays inside the pixel, averaged after clamping
+    Vec3f sum;
+    for (int sy = 0; sy < sampleGrid; sy++) {
+        for (int sx = 0; sx < sampleGrid; sx++) {
+            Ray rayFromCamera = calculateSubpixelRay(camera, x + (sx + 0.5f) / sampleGrid, y + (sy + 0.5f) / sampleGrid);
             rayFromCamera.depth = 0;
 
-            Vec3f computedColor = computeColor(&rayFromCamera, nullptr);
-            computedColor = clamp(computedColor);
-            result->setPixel(x, y, computedColor.x, computedColor.y, computedColor.z);
+            Vec3f sampleColor = computeColor(&rayFromCamera, nullptr);
+            sum = sum + clamp(sampleColor);
         }
     }
+    return sum / (float)(sampleGrid * sampleGrid);
 }
 
-std::vector<RenderResult*> RayTracer::render(const Scene& sceneToRender) {
+std::vector<RenderResult*> RayTracer::render(const std::shared_ptr<const Scene>& sceneToRender, const CameraCallback& onCamera) {
     scene = sceneToRender;
-    size_t cameraCount = scene.cameras.size();
+
+    RenderPass pass;
+    pass.pixel_step = 1;
+    pass.sample_grid = settings.antialiasing;
+    pass.recursion_limit = scene->max_recursion_depth;
+    pass.deadline_bound = false;
+
+    return renderPasses({pass}, nullptr, onCamera);
+}
+
+std::vector<RenderResult*> RayTracer::renderProgressive(const std::shared_ptr<const Scene>& sceneToRender, const PassCallback& onPass) {
+    scene = sceneToRender;
+    std::vector<RenderPass> passes;
+
+    // A quick preview: one sample per 4x4 block, direct lighting only. Always completed, so there is an image.
+    RenderPass coarse;
+    coarse.pixel_step = 4;
+    coarse.sample_grid = 1;
+    coarse.recursion_limit = 0;
+    coarse.deadline_bound = false;
+    passes.push_back(coarse);
+
+    RenderPass full;
+    full.pixel_step = 1;
+    full.sample_grid = 1;
+    full.recursion_limit = scene->max_recursion_depth;
+    full.deadline_bound = true;
+    passes.push_back(full);
+
+    if (settings.antialiasing > 1) {
+        RenderPass antialiased = full;
+        antialiased.sample_grid = settings.antialiasing;
+        passes.push_back(antialiased);
+    }
+
+    return renderPasses(passes, onPass, nullptr);
+}
+
+std::vector<RenderResult*> RayTracer::renderPasses(const std::vector<RenderPass>& passes, const PassCallback& onPass, const CameraCallback& onCamera) {
+    size_t cameraCount = scene->cameras.size();
     std::vector<RenderResult*> results;
 
-    // Create a thread pool with the number of available hardware threads
-    unsigned int numThreads = 4;
-    ThreadPool threadPool(numThreads);
+    stats = RenderStats();
+    stats.thread_count = settings.thread_count;
+    stats.tile_order = settings.tile_order;
+    stats.tile_size = settings.tile_size;
+    stats.tile_schedule = settings.tile_schedule;
+    stats.primary_visibility = settings.primary_visibility;
+    stats.thread_placement = settings.thread_placement;
+    rayCount = 0;
+    shadowRayCount = 0;
+    blockedShadowRays = 0;
+    occluderHits = 0;
+    culledTiles = 0;
+    tileEntryCount = 0;
+    lights.assign(scene->point_lights);
+
+    // Opened before the pool so that the worker threads inherit the counters
+    CacheCounters cacheCounters;
+    auto renderStart = std::chrono::steady_clock::now();
+    auto deadline = renderStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(settings.deadline_seconds));
+    {
+        // Declared before the pool, so it outlives the tiles that read it
+        std::vector<VisibilityBuffer> visibilityBuffers;
+        ThreadPool threadPool(placeWorkers(NumaTopology::detect(), settings.thread_placement, settings.thread_count));
+        size_t groupCount = threadPool.groupsCount();
+        stats.numa_groups = groupCount;
+
+        AccelerationKind kind = settings.acceleration;
+        if (kind == AccelerationKind::Auto) {
+            kind = chooseAcceleration(scene->render_objects);
+            stats.acceleration_automatic = true;
+        }
+        if (kind == AccelerationKind::Grid) {
+            acceleration.reset(new Grid());
+        }
+        else if (kind == AccelerationKind::Linear) {
+            acceleration.reset(new LinearScan());
+        }
+        else {
+            acceleration.reset(new Bvh(settings.bvh_layout));
+        }
+        acceleration->build(scene->render_objects, threadPool);
+        acceleration->recordStats(stats);
+
+        replicas.clear();
+        if (settings.replicate_scene && groupCount > 1) {
+            replicateScene(threadPool);
+            stats.replicated = true;
+        }
 
-    for (int i = 0; i < cameraCount; i++) {
-        Camera camera = scene.cameras[i];
-        auto* result = new RenderResult(camera.image_name.c_str(), camera.image_width, camera.image_height);
+        if (settings.primary_visibility == PrimaryVisibility::Rasterized) {
+            auto rasterStart = std::chrono::steady_clock::now();
+            Rasterizer rasterizer;
+            visibilityBuffers.reserve(cameraCount);
+            for (const Camera& camera : scene->cameras) {
+                visibilityBuffers.emplace_back(camera.image_width, camera.image_height);
+                stats.raster_unresolved_pixels += rasterizer.rasterize(*scene, camera, threadPool, visibilityBuffers.back());
+            }
+            stats.raster_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - rasterStart).count();
+        }
 
-        // Divide the rendering task among threads using the thread pool
-        for (int t = 0; t < numThreads; t++) {
-            int startY = t * (camera.image_height / numThreads);
-            int endY = (t == numThreads - 1) ? camera.image_height : (t + 1) * (camera.image_height / numThreads);
+        // Tiles are generated along a space filling curve, so the workers pick up neighbouring tiles together
+        // as long as the costs do not reorder them
+        std::vector<std::vector<Tile>> cameraTiles;
+        size_t tilesPerPass = 0;
+        for (const Camera& camera : scene->cameras) {
+            results.push_back(new RenderResult(camera.image_name.c_str(), camera.image_width, camera.image_height));
+            stats.pixel_count += (uint64_t)camera.image_width * camera.image_height;
+            cameraTiles.push_back(generateTiles(camera.image_width, camera.image_height, settings.tile_size, settings.tile_order));
+            tilesPerPass += cameraTiles.back().size();
+        }
 
-            threadPool.enqueue([this, camera, result, startY, endY]() {
-                renderPartial(scene, camera, result, 0, camera.image_width, startY, endY);
-            });
+        // Costs measured by the previous render only describe the same tiles
+        bool costsKnown = tileSeconds.size() == cameraCount;
+        for (size_t i = 0; costsKnown && i < cameraCount; i++) {
+            costsKnown = tileSeconds[i].size() == cameraTiles[i].size();
+        }
+        if (!costsKnown) {
+            tileSeconds.assign(cameraCount, std::vector<float>());
+            for (size_t i = 0; i < cameraCount; i++) {
+                tileSeconds[i].assign(cameraTiles[i].size(), 0.0f);
+            }
+        }
+        stats.reused_tile_costs = costsKnown && settings.tile_schedule == TileSchedule::CostFirst;
+
+        std::atomic<uint64_t> skippedTiles(0);
+        std::atomic<uint64_t> tileNanoseconds(0);
+
+        // Queues the tiles in the given order and waits for them, recording the time every tile took
+        auto runTiles = [&](const std::vector<ScheduledTile>& order, const RenderPass& pass, bool checkDeadline, const CameraCallback& onCameraDone) {
+            // Workers are idle between passes, so the limit can change here
+            recursionLimit = pass.recursion_limit;
+
+            std::vector<std::atomic<size_t>> remainingTiles(cameraCount);
+            for (const ScheduledTile& scheduled : order) {
+                remainingTiles[scheduled.camera]++;
+            }
+
+            std::vector<std::future<void>> pending;
+            pending.reserve(order.size());
+            for (const ScheduledTile& scheduled : order) {
+                const Camera& camera = scene->cameras[scheduled.camera];
+                const Tile& tile = cameraTiles[scheduled.camera][scheduled.tile];
+                // Horizontal bands of the image belong to the groups, so the framebuffer pages of
+                // a band are first touched, and therefore allocated, on the node that renders it
+                size_t group = (size_t)tile.startY * groupCount / camera.image_height;
+                pending.push_back(threadPool.enqueueOn(group, false, [&, scheduled]() {
+                    RenderResult* result = results[scheduled.camera];
+                    // Tiles that miss the deadline keep the image of the previous pass
+                    if (checkDeadline && std::chrono::steady_clock::now() >= deadline) {
+                        skippedTiles++;
+                    }
+                    else {
+                        const VisibilityBuffer* visibility = visibilityBuffers.empty() ? nullptr : &visibilityBuffers[scheduled.camera];
+                        auto tileStart = std::chrono::steady_clock::now();
+                        renderPartial(scene->cameras[scheduled.camera], result, cameraTiles[scheduled.camera][scheduled.tile], visibility, pass);
+                        auto elapsed = std::chrono::steady_clock::now() - tileStart;
+                        tileSeconds[scheduled.camera][scheduled.tile] = std::chrono::duration<float>(elapsed).count();
+                        tileNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+                    }
+                    if (--remainingTiles[scheduled.camera] == 0 && onCameraDone) {
+                        onCameraDone(result, scheduled.camera);
+                    }
+                }));
+            }
+            for (auto& task : pending) {
+                task.get();
+            }
+        };
+
+        auto tileOrder = [&]() {
+            std::vector<ScheduledTile> order;
+            for (size_t i = 0; i < cameraCount; i++) {
+                float cameraCost = 0;
+                for (float seconds : tileSeconds[i]) {
+                    cameraCost += seconds;
+                }
+                for (size_t t = 0; t < cameraTiles[i].size(); t++) {
+                    order.push_back({i, t, tileSeconds[i][t], cameraCost});
+                }
+            }
+            // The most expensive camera goes first and the most expensive tile of a camera first, so that the
+            // last tiles to finish are short ones while the cameras still complete one after the other rather
+            // than all at the end. Equal costs keep the curve order.
+            if (settings.tile_schedule == TileSchedule::CostFirst) {
+                std::stable_sort(order.begin(), order.end(), [](const ScheduledTile& a, const ScheduledTile& b) {
+                    return a.camera_cost != b.camera_cost ? a.camera_cost > b.camera_cost : a.cost > b.cost;
+                });
+            }
+            return order;
+        };
+
+        for (size_t passIndex = 0; passIndex < passes.size(); passIndex++) {
+            const RenderPass& pass = passes[passIndex];
+            bool checkDeadline = pass.deadline_bound && settings.deadline_seconds > 0;
+            if (checkDeadline && std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+
+            // Without measured costs, a full resolution pass is preceded by a probe that traces a few pixels of every
+            // tile. Coarse passes are cheap enough to run unordered, their times serve as the estimate of the next pass.
+            auto passStart = std::chrono::steady_clock::now();
+            if (settings.tile_schedule == TileSchedule::CostFirst && !costsKnown && pass.pixel_step == 1) {
+                RenderPass probe = pass;
+                probe.pixel_step = std::max(settings.tile_size / 2, 1);
+                probe.sample_grid = 1;
+                probe.deadline_bound = false;
+
+                runTiles(tileOrder(), probe, false, nullptr);
+                stats.probe_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - passStart).count();
+            }
+            costsKnown = true;
+
+            bool lastPass = passIndex + 1 == passes.size();
+            runTiles(tileOrder(), pass, checkDeadline, lastPass ? onCamera : nullptr);
+            stats.pass_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - passStart).count();
+            stats.tile_count += tilesPerPass;
+            stats.pass_count++;
+
+            if (onPass) {
+                onPass(results, passIndex);
+            }
         }
 
-        results.push_back(result);
+        stats.tile_count -= skippedTiles;
+        stats.skipped_tile_count = skippedTiles;
+        stats.tile_seconds = tileNanoseconds / 1e9;
     }
 
+    stats.render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+    stats.ray_count = rayCount;
+    stats.shadow_ray_count = shadowRayCount;
+    stats.blocked_shadow_ray_count = blockedShadowRays;
+    stats.occluder_cache_hits = occluderHits;
+    stats.culled_tile_count = culledTiles;
+    stats.tile_entry_count = tileEntryCount;
+    stats.cache = cacheCounters.read();
+    replicas.clear();
+
     return results;
 }
 
+void RayTracer::replicateScene(ThreadPool& threadPool) {
+    replicas.resize(threadPool.groupsCount());
+    std::vector<std::future<void>> pending;
+
+    // Pinned to the group, so every copy is allocated by a worker of its own node
+    for (size_t group = 0; group < replicas.size(); group++) {
+        pending.push_back(threadPool.enqueueOn(group, true, [this, group]() {
+            auto replica = std::unique_ptr<SceneReplica>(new SceneReplica());
+            replica->arena.reserve(scene->arena.usedBytes());
+            replica->objects.reserve(scene->render_objects.size());
+            for (RenderObject* object : scene->render_objects) {
+                replica->objects.push_back(object->cloneInto(replica->arena));
+            }
+            replica->acceleration = acceleration->cloneFor(replica->objects);
+            replicas[group] = std::move(replica);
+        }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+}
+
 Vec3f RayTracer::computeColor(Ray *ray, RenderObject* ignoredObject) {
 
-    if (ray->depth > scene.max_recursion_depth){
+    if (ray->depth > recursionLimit){
         return Vec3f(0, 0, 0);
     }
 
     float tHit;
     RenderObject* hitObject = raycast(ray, tHit, ignoredObject);
+    return shadeHit(ray, hitObject, tHit);
+}
 
+// Color along a ray whose closest hit, if any, is already known
+Vec3f RayTracer::shadeHit(Ray* ray, RenderObject* hitObject, float tHit) {
     if (hitObject != nullptr){
         return applyShading(hitObject, ray, tHit);
     }
     else if (ray->depth == 0){
-        Color bg = scene.background_color;
+        Color bg = scene->background_color;
         return Vec3f(bg.r, bg.g, bg.b);
     }
     else{
@@ -91,12 +472,12 @@ Vec3f RayTracer::computeColor(Ray *ray, RenderObject* ignoredObject) {
 
 Vec3f RayTracer::applyShading(RenderObject* hitObject, Ray* ray, const float& tHit){
 
-    Material mat = scene.materials[hitObject->material_id];
+    Material mat = scene->materials[hitObject->material_id];
     Vec3f intersectionPoint = ray->origin + ray->direction * tHit;
-    Vec3f intersectionNormal = hitObject->getNormal(scene, intersectionPoint);
-    size_t lightCount = scene.point_lights.size();
+    Vec3f intersectionNormal = hitObject->getNormal(*scene, intersectionPoint);
+    size_t lightCount = lights.size();
 
-    Vec3f shadedColor = scene.ambient_light * mat.ambient;
+    Vec3f shadedColor = scene->ambient_light * mat.ambient;
 
     if (mat.is_mirror){
 
@@ -108,46 +489,52 @@ Vec3f RayTracer::applyShading(RenderObject* hitObject, Ray* ray, const float& tH
         shadedColor = shadedColor + computeColor(reflectionRay, hitObject) * (mat.mirror);
     }
 
-    for (size_t lightIndex = 0; lightIndex < lightCount; lightIndex++) {
-        PointLight light = scene.point_lights[lightIndex];
-
-        Ray rayToLight;
-        rayToLight.origin = intersectionPoint + intersectionNormal * scene.shadow_ray_epsilon;
-        rayToLight.direction = (light.position - intersectionPoint).normalized();
-
-        float tBlocker;
-
-        RenderObject* lightBlockerObject = raycast(&rayToLight, tBlocker, hitObject);
-        if (lightBlockerObject != nullptr && tBlocker < (light.position - intersectionPoint).length() && tBlocker > 0){
-            continue;
+    ShadingPoint point;
+    point.position = intersectionPoint;
+    point.normal = intersectionNormal;
+    point.to_viewer = (ray->direction * -1).normalized();
+    point.diffuse = mat.diffuse;
+    point.specular = mat.specular;
+    point.phong_exponent = mat.phong_exponent;
+
+    Ray rayToLight;
+    rayToLight.origin = intersectionPoint + intersectionNormal * scene->shadow_ray_epsilon;
+
+    // Lights are shaded a batch at a time, then the lights that would add anything are masked by shadow rays
+    LightBatch batch;
+    for (size_t first = 0; first < lightCount; first += LightBatch::width) {
+        lights.shade(first, point, batch);
+
+        int lanes = (int)std::min<size_t>(LightBatch::width, lightCount - first);
+        for (int lane = 0; lane < lanes; lane++) {
+            Vec3f contribution(batch.red[lane], batch.green[lane], batch.blue[lane]);
+            if (contribution.x == 0.0f && contribution.y == 0.0f && contribution.z == 0.0f) {
+                continue;
+            }
+
+            rayToLight.direction = Vec3f(batch.direction_x[lane], batch.direction_y[lane], batch.direction_z[lane]);
+            if (isOccluded(&rayToLight, batch.distance[lane], hitObject, first + lane)) {
+                continue;
+            }
+
+            shadedColor = shadedColor + contribution;
         }
-
-        shadedColor = shadedColor + calculateDiffuse(
-                mat,
-                rayToLight,
-                intersectionNormal,
-                light,
-                intersectionPoint);
-
-        shadedColor = shadedColor + calculateSpecular(
-                mat,
-                light,
-                rayToLight.direction,
-                ray->direction * -1,
-                intersectionPoint,
-                intersectionNormal);
     }
 
     return shadedColor;
 }
 
 Ray RayTracer::calculateRayFromCamera(const Camera& camera, int x, int y) {
+	return calculateSubpixelRay(camera, x + 0.5f, y + 0.5f);
+}
+
+Ray RayTracer::calculateSubpixelRay(const Camera& camera, float x, float y) {
 	Ray ray;
 
 	Vec3f e = camera.position;
 
-	float su = (x + 0.5f) * camera.pixel_width;
-	float sv = (y + 0.5f) * camera.pixel_height;
+	float su = x * camera.pixel_width;
+	float sv = y * camera.pixel_height;
 
 	Vec3f s = camera.q + camera.u * su - camera.v * sv;
 
@@ -157,43 +544,6 @@ Ray RayTracer::calculateRayFromCamera(const Camera& camera, int x, int y) {
 	return ray;
 }
 
-Vec3f RayTracer::calculateDiffuse(const Material& mat, const Ray& rayFromLight, const Vec3f& surfaceNormal, const PointLight& light, const Vec3f& intersectionPoint)
-{
-	Vec3f lightDirection = rayFromLight.direction.normalized();
-	float cosTheta = std::max(0.0f, lightDirection.dot(surfaceNormal));
-	Vec3f diffuseColor = mat.diffuse;
-    return diffuseColor * cosTheta * calculateIrradiance(light, intersectionPoint);
-}
-
-Vec3f RayTracer::calculateIrradiance(const PointLight& pointLight, const Vec3f& intersectionPoint){
-    Vec3f irradiance;
-
-    Vec3f d = pointLight.position - intersectionPoint;
-    float d_square = d.length() * d.length();
-
-    if (d_square != 0.0f){
-        irradiance.x = pointLight.intensity.x/d_square;
-        irradiance.y = pointLight.intensity.y/d_square;
-        irradiance.z = pointLight.intensity.z/d_square;
-    }
-
-    return irradiance;
-}
-
-Vec3f RayTracer::calculateSpecular(const Material& mat,
-                                   const PointLight& pointLight,
-                                   const Vec3f& rayDirectionFromIntersectionToLight,
-                                   const Vec3f& rayDirectionFromIntersectionToCamera,
-                                   const Vec3f& intersectionPoint,
-                                   const Vec3f& intersectionNormal) {
-    Vec3f sum = (rayDirectionFromIntersectionToLight.normalized() + rayDirectionFromIntersectionToCamera.normalized());
-    Vec3f halfVector = ((sum) / (sum.length())).normalized();
-
-    float cosAlpha = max(0.0f, intersectionNormal.dot(halfVector));
-
-    return mat.specular * pow(cosAlpha, mat.phong_exponent) * calculateIrradiance(pointLight, intersectionPoint);
-}
-
 Vec3f RayTracer::clamp(Vec3f& x)
 {
 	if (x.x > 255)	x.x = 255;
@@ -213,9 +563,11 @@ RenderResult::RenderResult(const char* imageName, int width, int height) : width
 	strcpy(image_name, imageName);
 
 	image = new Color[width * height];
+	MemoryTracker::allocated(MemoryCategory::Framebuffers, sizeof(Color) * width * height);
 }
 
 RenderResult::~RenderResult() {
+	MemoryTracker::released(MemoryCategory::Framebuffers, sizeof(Color) * width * height);
 	delete[] image_name;
 	delete[] image;
 }
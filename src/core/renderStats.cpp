@@ -0,0 +1,87 @@
+#include "../../include/core/renderStats.h"
+#include <iomanip>
+
+static double percentage(uint64_t part, uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * (double)part / (double)whole;
+}
+
+void RenderStats::print(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+
+    out << "Render stats" << std::endl;
+    out << "  threads:        " << thread_count << " (placement " << threadPlacementName(thread_placement)
+        << ", " << numa_groups << " node groups" << (replicated ? ", replicated scene" : "") << ")" << std::endl;
+    out << "  tile order:     " << tileOrderName(tile_order)
+        << " (" << tile_size << "x" << tile_size << " tiles, z-order pixels)" << std::endl;
+    out << "  schedule:       " << tileScheduleName(tile_schedule);
+    if (tile_schedule == TileSchedule::CostFirst) {
+        if (reused_tile_costs) {
+            out << " (costs of the previous render)";
+        }
+        else if (probe_seconds > 0) {
+            out << " (probe " << probe_seconds << " s)";
+        }
+    }
+    out << std::endl;
+    out << "  primary rays:   " << primaryVisibilityName(primary_visibility);
+    if (primary_visibility == PrimaryVisibility::Rasterized) {
+        out << " (" << raster_seconds << " s, " << raster_unresolved_pixels << " pixels traced)";
+    }
+    out << std::endl;
+    out << "  acceleration:   " << accelerationKindName(acceleration)
+        << (acceleration_automatic ? " (automatic)" : "") << std::endl;
+    if (acceleration == AccelerationKind::Grid) {
+        out << "  grid build:     " << grid.build_seconds << " s, " << grid.primitive_count << " primitives" << std::endl;
+        out << "  grid cells:     " << grid.resolution[0] << "x" << grid.resolution[1] << "x" << grid.resolution[2]
+            << " top, " << grid.subgrid_count << " sub-grids, " << grid.cell_count << " cells, "
+            << grid.references_per_primitive << " references per primitive" << std::endl;
+        out << "  grid memory:    " << grid.memory_bytes / 1024.0 << " KiB" << std::endl;
+    }
+    else if (acceleration == AccelerationKind::Bvh) {
+        out << "  bvh layout:     " << bvhLayoutName(bvh.layout) << std::endl;
+        out << "  bvh build:      " << bvh.build_seconds << " s, " << bvh.primitive_count << " primitives" << std::endl;
+        out << "  bvh quality:    " << bvh.node_count << " nodes, " << bvh.leaf_count << " leaves, depth "
+            << bvh.max_depth << ", SAH cost " << bvh.sah_cost << std::endl;
+        out << "  bvh memory:     " << bvh.memory_bytes / 1024.0 << " KiB" << std::endl;
+    }
+    out << "  passes:         " << pass_count << std::endl;
+    out << "  tiles:          " << tile_count;
+    if (skipped_tile_count > 0) {
+        out << " (" << skipped_tile_count << " skipped at the deadline)";
+    }
+    out << std::endl;
+    out << "  pixels:         " << pixel_count << std::endl;
+    out << "  rays:           " << ray_count << std::endl;
+    out << "  shadow rays:    " << shadow_ray_count << ", " << blocked_shadow_ray_count << " blocked" << std::endl;
+    out << "  occluder cache: " << percentage(occluder_cache_hits, shadow_ray_count) << "% hit rate, "
+        << percentage(occluder_cache_hits, blocked_shadow_ray_count) << "% of the blocked rays" << std::endl;
+    if (culled_tile_count > 0) {
+        out << "  tile culling:   " << culled_tile_count << " tiles, "
+            << (double)tile_entry_count / culled_tile_count << " subtrees per tile" << std::endl;
+    }
+    out << "  render time:    " << render_seconds << " s" << std::endl;
+    if (pass_seconds > 0 && thread_count > 0) {
+        // A perfect schedule keeps every worker busy until the last tile, the makespan is then the work over the workers
+        out << "  tile work:      " << tile_seconds << " s in " << pass_seconds << " s of passes, "
+            << 100.0 * tile_seconds / (pass_seconds * thread_count) << "% of the worker time" << std::endl;
+    }
+
+    if (render_seconds > 0) {
+        out << "  throughput:     " << pixel_count / render_seconds / 1e6 << " Mpixel/s, "
+            << ray_count / render_seconds / 1e6 << " Mray/s" << std::endl;
+    }
+
+    if (cache.available) {
+        out << std::setprecision(2);
+        out << "  L1D hit rate:   " << 100.0 - percentage(cache.l1_misses, cache.l1_accesses)
+            << "% (" << cache.l1_accesses << " loads)" << std::endl;
+        out << "  LLC hit rate:   " << 100.0 - percentage(cache.llc_misses, cache.llc_accesses)
+            << "% (" << cache.llc_accesses << " loads)" << std::endl;
+    }
+    else {
+        out << "  cache counters: unavailable" << std::endl;
+    }
+
+    out.flags(flags);
+}
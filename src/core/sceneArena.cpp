@@ -0,0 +1,92 @@
+#include "../../include/core/sceneArena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+const size_t firstBlockSize = 64 * 1024;
+// Blocks are at most this large, unless a single reservation needs more
+const size_t largestBlockSize = 64 * 1024 * 1024;
+
+}
+
+SceneArena::SceneArena(SceneArena&& other) noexcept
+    : blocks(std::move(other.blocks)), next(other.next), end(other.end),
+      used_bytes(other.used_bytes), capacity_bytes(other.capacity_bytes) {
+    other.blocks.clear();
+    other.next = other.end = nullptr;
+    other.used_bytes = other.capacity_bytes = 0;
+}
+
+SceneArena& SceneArena::operator=(SceneArena&& other) noexcept {
+    if (this != &other) {
+        release();
+        blocks = std::move(other.blocks);
+        next = other.next;
+        end = other.end;
+        used_bytes = other.used_bytes;
+        capacity_bytes = other.capacity_bytes;
+        other.blocks.clear();
+        other.next = other.end = nullptr;
+        other.used_bytes = other.capacity_bytes = 0;
+    }
+    return *this;
+}
+
+SceneArena::~SceneArena() {
+    release();
+}
+
+void SceneArena::reserve(size_t bytes) {
+    if ((size_t)(end - next) < bytes) {
+        addBlock(bytes);
+    }
+}
+
+size_t SceneArena::usedBytes() const {
+    return used_bytes;
+}
+
+size_t SceneArena::capacityBytes() const {
+    return capacity_bytes;
+}
+
+void* SceneArena::allocate(size_t size, size_t alignment) {
+    uintptr_t address = ((uintptr_t)next + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (next == nullptr || address + size > (uintptr_t)end) {
+        addBlock(size + alignment);
+        address = ((uintptr_t)next + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+    next = (char*)(address + size);
+    used_bytes += size;
+    return (void*)address;
+}
+
+void SceneArena::addBlock(size_t minimumSize) {
+    // Every block is twice as large as the one before, so the number of blocks grows with the log of the scene.
+    // The size follows the number of blocks rather than their total, one large mesh does not make the next block large.
+    size_t size = firstBlockSize;
+    for (size_t i = 0; i < blocks.size() && size < largestBlockSize; i++) {
+        size *= 2;
+    }
+    size = std::max(size, minimumSize);
+    Block block;
+    block.memory = static_cast<char*>(::operator new(size));
+    block.size = size;
+    blocks.push_back(block);
+    MemoryTracker::allocated(MemoryCategory::Primitives, size);
+
+    next = block.memory;
+    end = block.memory + size;
+    capacity_bytes += size;
+}
+
+void SceneArena::release() {
+    for (const Block& block : blocks) {
+        MemoryTracker::released(MemoryCategory::Primitives, block.size);
+        ::operator delete(block.memory);
+    }
+    blocks.clear();
+    next = end = nullptr;
+    used_bytes = capacity_bytes = 0;
+}
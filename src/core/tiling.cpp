@@ -0,0 +1,147 @@
+#include "../../include/core/tiling.h"
+#include <algorithm>
+#include <cstring>
+
+// Spreads the lower 16 bits of x so that there is a zero bit between each of them
+static uint32_t spreadBits(uint32_t x) {
+    x &= 0x0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+// Inverse of spreadBits, gathers every second bit
+static uint32_t compactBits(uint32_t x) {
+    x &= 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0f0f0f0f;
+    x = (x | (x >> 4)) & 0x00ff00ff;
+    x = (x | (x >> 8)) & 0x0000ffff;
+    return x;
+}
+
+uint32_t encodeMorton(uint32_t x, uint32_t y) {
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+void decodeMorton(uint32_t index, uint32_t& x, uint32_t& y) {
+    x = compactBits(index);
+    y = compactBits(index >> 1);
+}
+
+uint32_t encodeHilbert(uint32_t gridSize, uint32_t x, uint32_t y) {
+    uint32_t d = 0;
+    for (uint32_t s = gridSize / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so that the curve stays continuous
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+std::vector<Tile> generateTiles(int width, int height, int tileSize, TileOrder order) {
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+
+    uint32_t gridSize = 1;
+    while (gridSize < (uint32_t)std::max(tilesX, tilesY)) {
+        gridSize *= 2;
+    }
+
+    std::vector<std::pair<uint32_t, Tile>> keyedTiles;
+    keyedTiles.reserve(tilesX * tilesY);
+
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            Tile tile;
+            tile.startX = tx * tileSize;
+            tile.endX = std::min(width, tile.startX + tileSize);
+            tile.startY = ty * tileSize;
+            tile.endY = std::min(height, tile.startY + tileSize);
+
+            uint32_t key;
+            switch (order) {
+                case TileOrder::Morton:
+                    key = encodeMorton(tx, ty);
+                    break;
+                case TileOrder::Hilbert:
+                    key = encodeHilbert(gridSize, tx, ty);
+                    break;
+                default:
+                    key = ty * tilesX + tx;
+                    break;
+            }
+            keyedTiles.emplace_back(key, tile);
+        }
+    }
+
+    std::sort(keyedTiles.begin(), keyedTiles.end(),
+              [](const std::pair<uint32_t, Tile>& a, const std::pair<uint32_t, Tile>& b) { return a.first < b.first; });
+
+    std::vector<Tile> tiles;
+    tiles.reserve(keyedTiles.size());
+    for (const auto& keyedTile : keyedTiles) {
+        tiles.push_back(keyedTile.second);
+    }
+    return tiles;
+}
+
+const char* tileOrderName(TileOrder order) {
+    switch (order) {
+        case TileOrder::Morton:
+            return "morton";
+        case TileOrder::Hilbert:
+            return "hilbert";
+        default:
+            return "scanline";
+    }
+}
+
+bool parseTileOrder(const char* name, TileOrder& order) {
+    if (strcmp(name, "scanline") == 0) {
+        order = TileOrder::Scanline;
+    }
+    else if (strcmp(name, "morton") == 0) {
+        order = TileOrder::Morton;
+    }
+    else if (strcmp(name, "hilbert") == 0) {
+        order = TileOrder::Hilbert;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+const char* tileScheduleName(TileSchedule schedule) {
+    switch (schedule) {
+        case TileSchedule::CostFirst:
+            return "cost";
+        default:
+            return "ordered";
+    }
+}
+
+bool parseTileSchedule(const char* name, TileSchedule& schedule) {
+    if (strcmp(name, "ordered") == 0) {
+        schedule = TileSchedule::Ordered;
+    }
+    else if (strcmp(name, "cost") == 0) {
+        schedule = TileSchedule::CostFirst;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
@@ -1,7 +1,7 @@
 #include "../../../include/utilities.h"
 #include "../../../include/geometry/base/render_object.h"
 
-Vec3f RenderObject::getNormal(const Scene& scene, const Vec3f& intersectionPoint) {
+Vec3f RenderObject::getNormal(const Scene& scene, const Vec3f& intersectionPoint) const {
     //TODO
     return Vec3f(0, 0, 0);
 }
\ No newline at end of file
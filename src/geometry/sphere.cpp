@@ -1,6 +1,10 @@
 #include "../../include/geometry/sphere.h"
 
-Vec3f Sphere::getNormal(const Scene& scene, const Vec3f& intersectionPoint)
+Sphere::Sphere(int materialId, const Vec3f& center, float sphereRadius) : center_vertex(center), radius(sphereRadius) {
+    material_id = materialId;
+}
+
+Vec3f Sphere::getNormal(const Scene& scene, const Vec3f& intersectionPoint) const
 {
 	// Calculate the normal vector by subtracting the intersection point from the sphere's center
 	Vec3f normal = intersectionPoint - center_vertex;
@@ -11,22 +15,26 @@ Vec3f Sphere::getNormal(const Scene& scene, const Vec3f& intersectionPoint)
 	return normal;
 }
 
-bool Sphere::intersect(Ray* ray, float &t, const float& epsilon) {
+bool Sphere::intersect(Ray* ray, float &t, const float& epsilon) const {
     Vec3f oc = ray->origin - center_vertex;
-    float a = ray->direction.dot(ray->direction.normalized());
-    float b = 2.0f * oc.dot(ray->direction);
+    float a = ray->direction.dot(ray->direction);
+    float halfB = oc.dot(ray->direction);
 
     float dot_oc = oc.dot(oc);
 
     if (dot_oc > -epsilon && dot_oc < epsilon)
         return false;
 
-    float c = dot_oc - radius * radius;
-    float discriminant = b * b - 4 * a * c;
+    // b^2 - 4ac from the distance of the center to the line of the ray. Subtracting the squares directly
+    // cancels all precision for small spheres far away, which then show up as hits where there are none.
+    Vec3f closest = oc - ray->direction * (halfB / a);
+    float discriminant = a * (radius * radius - closest.dot(closest));
 
     if (discriminant > 0) {
-        float t1 = (-b - std::sqrt(discriminant)) / (2.0f * a);
-        float t2 = (-b + std::sqrt(discriminant)) / (2.0f * a);
+        // The root that adds two numbers of the same sign is exact, the other one follows from their product c / a
+        float q = -(halfB + std::copysign(std::sqrt(discriminant), halfB));
+        float t1 = (dot_oc - radius * radius) / q;
+        float t2 = q / a;
         t = (t1 < t2) ? t1 : t2;
         if (t < 0){
             return false;
@@ -34,10 +42,18 @@ bool Sphere::intersect(Ray* ray, float &t, const float& epsilon) {
         return true;
     }
     else if (discriminant == 0) {
-        t = -b / (2.0f * a);
+        t = -halfB / a;
         return true;
     }
 
     return false;
 }
 
+BoundingBox Sphere::getBounds() const {
+    Vec3f extent(radius, radius, radius);
+    return BoundingBox(center_vertex - extent, center_vertex + extent);
+}
+
+RenderObject* Sphere::cloneInto(SceneArena& arena) const {
+    return arena.create<Sphere>(*this);
+}
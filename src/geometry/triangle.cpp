@@ -1,9 +1,8 @@
 #include "../../include/geometry/triangle.h"
 
-Vec3f Triangle::getNormal(const Scene& scene, const Vec3f& intersectionPoint) {
-	if (isCalculated) {
-		return normal;
-	}
+Triangle::Triangle(int materialId, const Vec3f& v0, const Vec3f& v1, const Vec3f& v2)
+	: vertex_0(v0), vertex_1(v1), vertex_2(v2) {
+	material_id = materialId;
 
 	// Calculate two edges of the triangle
 	Vec3f edge1 = vertex_1 - vertex_0;
@@ -14,13 +13,13 @@ Vec3f Triangle::getNormal(const Scene& scene, const Vec3f& intersectionPoint) {
 
 	// Normalize the normal vector
     normal = normal.normalized();
+}
 
-	isCalculated = true;
-
+Vec3f Triangle::getNormal(const Scene& scene, const Vec3f& intersectionPoint) const {
 	return normal;
 }
 
-bool Triangle::intersect(Ray* ray, float &t, const float& epsilon) {
+bool Triangle::intersect(Ray* ray, float &t, const float& epsilon) const {
     Vec3f e1 = vertex_1 - vertex_0;
     Vec3f e2 = vertex_2 - vertex_0;
     Vec3f h = ray->direction.cross(e2);
@@ -53,3 +52,15 @@ bool Triangle::intersect(Ray* ray, float &t, const float& epsilon) {
     }
     return true;
 }
+
+BoundingBox Triangle::getBounds() const {
+    BoundingBox bounds;
+    bounds.expand(vertex_0);
+    bounds.expand(vertex_1);
+    bounds.expand(vertex_2);
+    return bounds;
+}
+
+RenderObject* Triangle::cloneInto(SceneArena& arena) const {
+    return arena.create<Triangle>(*this);
+}
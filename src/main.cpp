@@ -1,14 +1,63 @@
 #include "../include/tools/exporter.h"
 #include "../include/tools/importer.h"
+#include "../include/tools/arguments.h"
+#include "../include/tools/benchmark.h"
+#include "../include/tools/regression.h"
 
 int main(int argc, char* argv[])
 {
-    Importer importer;
-    Scene parsedScene = importer.importXml(argv[1]);
+    Arguments arguments = parseArguments(argc, argv);
 
-    RayTracer rayTracer;
-    vector<RenderResult*> results = rayTracer.render(parsedScene);
+    if (!arguments.regression.baseline_path.empty()) {
+        RegressionHarness harness;
+        bool passed = harness.run(arguments.regression, arguments.settings, std::cout);
+        if (arguments.print_memory) {
+            MemoryTracker::print(std::cout);
+        }
+        return passed ? 0 : 1;
+    }
 
+    Importer importer(arguments.settings.thread_count);
+    // Immutable from here on, the renderers share it
+    auto parsedScene = std::make_shared<const Scene>(importer.importXml(arguments.scene_path));
+
+    if (!arguments.benchmark.empty()) {
+        Benchmark benchmark;
+        if (arguments.benchmark == "bvh-layout") {
+            benchmark.compareBvhLayouts(parsedScene, arguments.settings, std::cout);
+        }
+        else if (arguments.benchmark == "placement") {
+            benchmark.compareThreadPlacements(parsedScene, arguments.settings, std::cout);
+        }
+        else {
+            benchmark.compareTileSchedules(parsedScene, arguments.settings, std::cout);
+        }
+        if (arguments.print_memory) {
+            MemoryTracker::print(std::cout);
+        }
+        return 0;
+    }
+
+    RayTracer rayTracer(arguments.settings);
     Exporter exporter;
-    exporter.exportPpm(results);
+
+    if (arguments.progressive) {
+        // Every pass overwrites the images with a better version
+        rayTracer.renderProgressive(parsedScene, [&exporter](const vector<RenderResult*>& results, int pass) {
+            exporter.exportPpm(results);
+        });
+    }
+    else {
+        // Every image is written as soon as its camera is done, while the others are still rendering
+        rayTracer.render(parsedScene, [&exporter](RenderResult* result, size_t camera) {
+            exporter.exportPpm({result});
+        });
+    }
+
+    if (arguments.print_stats) {
+        rayTracer.getStats().print(std::cout);
+    }
+    if (arguments.print_memory) {
+        MemoryTracker::print(std::cout);
+    }
 }
@@ -0,0 +1,162 @@
+#include "../../include/tools/arguments.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static const int maxTileSize = 32768;
+
+// Returns the value of "--name=value" if the argument matches the option name
+static const char* optionValue(const char* argument, const char* name) {
+    size_t length = strlen(name);
+    if (strncmp(argument, name, length) == 0 && argument[length] == '=') {
+        return argument + length + 1;
+    }
+    return nullptr;
+}
+
+static int parsePositive(const char* value, const char* name) {
+    char* end;
+    long parsed = strtol(value, &end, 10);
+    if (*end != '\0' || parsed <= 0) {
+        throw std::runtime_error(std::string("Error: ") + name + " expects a positive integer.");
+    }
+    return (int)parsed;
+}
+
+static int parseNonNegative(const char* value, const char* name) {
+    char* end;
+    long parsed = strtol(value, &end, 10);
+    if (*end != '\0' || parsed < 0) {
+        throw std::runtime_error(std::string("Error: ") + name + " expects a non-negative integer.");
+    }
+    return (int)parsed;
+}
+
+static double parsePercentage(const char* value, const char* name) {
+    char* end;
+    double parsed = strtod(value, &end);
+    if (*end != '\0' || !(parsed >= 0 && parsed <= 100)) {
+        throw std::runtime_error(std::string("Error: ") + name + " expects a percentage from 0 to 100.");
+    }
+    return parsed;
+}
+
+Arguments parseArguments(int argc, char* argv[]) {
+    Arguments arguments;
+    std::vector<std::string> scenePaths;
+
+    for (int i = 1; i < argc; i++) {
+        const char* argument = argv[i];
+        const char* value;
+
+        if ((value = optionValue(argument, "--threads"))) {
+            arguments.settings.thread_count = parsePositive(value, "--threads");
+        }
+        else if ((value = optionValue(argument, "--tile-size"))) {
+            // Larger tiles than any image are one tile anyway. Rounded up to a power of two, the pixels of a
+            // tile still have 32 bit z-order indices.
+            arguments.settings.tile_size = std::min(parsePositive(value, "--tile-size"), maxTileSize);
+        }
+        else if ((value = optionValue(argument, "--tile-order"))) {
+            if (!parseTileOrder(value, arguments.settings.tile_order)) {
+                throw std::runtime_error("Error: --tile-order must be scanline, morton or hilbert.");
+            }
+        }
+        else if ((value = optionValue(argument, "--schedule"))) {
+            if (!parseTileSchedule(value, arguments.settings.tile_schedule)) {
+                throw std::runtime_error("Error: --schedule must be ordered or cost.");
+            }
+        }
+        else if (strcmp(argument, "--no-tile-culling") == 0) {
+            arguments.settings.tile_culling = false;
+        }
+        else if ((value = optionValue(argument, "--accel"))) {
+            if (!parseAccelerationKind(value, arguments.settings.acceleration)) {
+                throw std::runtime_error("Error: --accel must be auto, bvh, grid or linear.");
+            }
+        }
+        else if ((value = optionValue(argument, "--bvh-layout"))) {
+            if (!parseBvhLayout(value, arguments.settings.bvh_layout)) {
+                throw std::runtime_error("Error: --bvh-layout must be binary or compressed.");
+            }
+        }
+        else if ((value = optionValue(argument, "--primary"))) {
+            if (!parsePrimaryVisibility(value, arguments.settings.primary_visibility)) {
+                throw std::runtime_error("Error: --primary must be raytrace or raster.");
+            }
+        }
+        else if ((value = optionValue(argument, "--aa"))) {
+            arguments.settings.antialiasing = parsePositive(value, "--aa");
+        }
+        else if ((value = optionValue(argument, "--deadline-ms"))) {
+            arguments.settings.deadline_seconds = parsePositive(value, "--deadline-ms") / 1000.0;
+        }
+        else if (strcmp(argument, "--progressive") == 0) {
+            arguments.progressive = true;
+        }
+        else if ((value = optionValue(argument, "--pin"))) {
+            if (!parseThreadPlacement(value, arguments.settings.thread_placement)) {
+                throw std::runtime_error("Error: --pin must be none, cores or numa.");
+            }
+        }
+        else if (strcmp(argument, "--replicate") == 0) {
+            arguments.settings.replicate_scene = true;
+        }
+        else if ((value = optionValue(argument, "--benchmark"))) {
+            if (strcmp(value, "bvh-layout") != 0 && strcmp(value, "placement") != 0 && strcmp(value, "schedule") != 0) {
+                throw std::runtime_error("Error: --benchmark must be bvh-layout, placement or schedule.");
+            }
+            arguments.benchmark = value;
+        }
+        else if ((value = optionValue(argument, "--regression"))) {
+            if (*value == '\0') {
+                throw std::runtime_error("Error: --regression expects the path of the baseline file.");
+            }
+            arguments.regression.baseline_path = value;
+        }
+        else if (strcmp(argument, "--update-baseline") == 0) {
+            arguments.regression.update_baseline = true;
+        }
+        else if ((value = optionValue(argument, "--tolerance"))) {
+            arguments.regression.pixel_tolerance = parseNonNegative(value, "--tolerance");
+        }
+        else if ((value = optionValue(argument, "--max-slowdown"))) {
+            arguments.regression.max_slowdown_percent = parsePercentage(value, "--max-slowdown");
+        }
+        else if ((value = optionValue(argument, "--runs"))) {
+            arguments.regression.runs = parsePositive(value, "--runs");
+        }
+        else if (strcmp(argument, "--stats") == 0) {
+            arguments.print_stats = true;
+        }
+        else if (strcmp(argument, "--memory") == 0) {
+            arguments.print_memory = true;
+        }
+        else if (strncmp(argument, "--", 2) == 0) {
+            throw std::runtime_error(std::string("Error: Unknown option ") + argument);
+        }
+        else {
+            scenePaths.push_back(argument);
+        }
+    }
+
+    // Only progressive renders stop at a deadline, a full render would silently ignore it
+    if (arguments.settings.deadline_seconds > 0 && !arguments.progressive) {
+        throw std::runtime_error("Error: --deadline-ms needs --progressive.");
+    }
+
+    // The harness renders every scene it is given, or its own scenes
+    if (!arguments.regression.baseline_path.empty()) {
+        arguments.regression.scene_paths = scenePaths;
+        return arguments;
+    }
+    if (scenePaths.empty()) {
+        throw std::runtime_error("Error: No scene file is given.");
+    }
+    if (scenePaths.size() > 1) {
+        throw std::runtime_error("Error: Only --regression takes more than one scene file.");
+    }
+    arguments.scene_path = scenePaths[0];
+
+    return arguments;
+}
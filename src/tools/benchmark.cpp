@@ -0,0 +1,168 @@
+#include "../../include/tools/benchmark.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+// Largest difference of a color channel between two sets of images of the same cameras
+static int maxPixelDifference(const vector<RenderResult*>& a, const vector<RenderResult*>& b) {
+    int difference = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        for (int p = 0; p < a[i]->width * a[i]->height; p++) {
+            difference = std::max(difference, std::abs(a[i]->image[p].r - b[i]->image[p].r));
+            difference = std::max(difference, std::abs(a[i]->image[p].g - b[i]->image[p].g));
+            difference = std::max(difference, std::abs(a[i]->image[p].b - b[i]->image[p].b));
+        }
+    }
+    return difference;
+}
+
+static void deleteResults(vector<RenderResult*>& results) {
+    for (RenderResult* result : results) {
+        delete result;
+    }
+    results.clear();
+}
+
+void Benchmark::compareBvhLayouts(const std::shared_ptr<const Scene>& scene, const RenderSettings& settings, std::ostream& out) const {
+    const BvhLayout layouts[] = {BvhLayout::Binary, BvhLayout::Compressed};
+    vector<RenderResult*> reference;
+
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << std::left << std::setw(12) << "layout" << std::right
+        << std::setw(10) << "nodes" << std::setw(14) << "memory KiB" << std::setw(10) << "build s"
+        << std::setw(10) << "render s" << std::setw(10) << "Mray/s" << std::setw(10) << "max diff" << std::endl;
+
+    for (BvhLayout layout : layouts) {
+        RenderSettings layoutSettings = settings;
+        layoutSettings.acceleration = AccelerationKind::Bvh;
+        layoutSettings.bvh_layout = layout;
+
+        RayTracer rayTracer(layoutSettings);
+        vector<RenderResult*> results = rayTracer.render(scene);
+        const RenderStats& stats = rayTracer.getStats();
+
+        if (reference.empty()) {
+            reference = results;
+        }
+        double traceSeconds = stats.render_seconds - stats.acceleration_build_seconds;
+
+        out << std::left << std::setw(12) << bvhLayoutName(layout) << std::right
+            << std::setw(10) << stats.bvh.node_count
+            << std::setw(14) << stats.bvh.memory_bytes / 1024.0
+            << std::setw(10) << stats.bvh.build_seconds
+            << std::setw(10) << traceSeconds
+            << std::setw(10) << (traceSeconds > 0 ? stats.ray_count / traceSeconds / 1e6 : 0.0)
+            << std::setw(10) << maxPixelDifference(reference, results) << std::endl;
+
+        if (results != reference) {
+            deleteResults(results);
+        }
+    }
+
+    deleteResults(reference);
+    out.flags(flags);
+}
+
+void Benchmark::compareThreadPlacements(const std::shared_ptr<const Scene>& scene, const RenderSettings& settings, std::ostream& out) const {
+    struct Configuration {
+        ThreadPlacement placement;
+        bool replicate;
+    };
+    const Configuration configurations[] = {
+            {ThreadPlacement::None, false},
+            {ThreadPlacement::Cores, false},
+            {ThreadPlacement::NumaNodes, false},
+            {ThreadPlacement::NumaNodes, true},
+    };
+
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << "NUMA nodes: " << NumaTopology::detect().node_cpus.size() << std::endl;
+    out << std::left << std::setw(20) << "placement" << std::right
+        << std::setw(10) << "threads" << std::setw(10) << "render s" << std::setw(10) << "Mray/s"
+        << std::setw(10) << "speedup" << std::endl;
+
+    for (const Configuration& configuration : configurations) {
+        double singleThreadSeconds = 0;
+
+        for (unsigned int threads = 1;; threads = std::min(threads * 2, settings.thread_count)) {
+            RenderSettings placementSettings = settings;
+            placementSettings.thread_count = threads;
+            placementSettings.thread_placement = configuration.placement;
+            placementSettings.replicate_scene = configuration.replicate;
+
+            RayTracer rayTracer(placementSettings);
+            vector<RenderResult*> results = rayTracer.render(scene);
+            deleteResults(results);
+
+            const RenderStats& stats = rayTracer.getStats();
+            double traceSeconds = stats.render_seconds - stats.acceleration_build_seconds;
+            if (threads == 1) {
+                singleThreadSeconds = traceSeconds;
+            }
+
+            std::string name = threadPlacementName(configuration.placement);
+            if (configuration.replicate) {
+                name += "+replicate";
+            }
+            out << std::left << std::setw(20) << name << std::right
+                << std::setw(10) << threads
+                << std::setw(10) << traceSeconds
+                << std::setw(10) << (traceSeconds > 0 ? stats.ray_count / traceSeconds / 1e6 : 0.0)
+                << std::setw(10) << (traceSeconds > 0 ? singleThreadSeconds / traceSeconds : 0.0) << std::endl;
+
+            if (threads >= settings.thread_count) {
+                break;
+            }
+        }
+    }
+
+    out.flags(flags);
+}
+
+void Benchmark::compareTileSchedules(const std::shared_ptr<const Scene>& scene, const RenderSettings& settings, std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << "cameras: " << scene->cameras.size() << ", threads: " << settings.thread_count << std::endl;
+    out << std::left << std::setw(20) << "schedule" << std::right
+        << std::setw(10) << "passes s" << std::setw(10) << "ideal s" << std::setw(10) << "busy %"
+        << std::setw(12) << "camera s" << std::endl;
+
+    RenderSettings orderedSettings = settings;
+    orderedSettings.tile_schedule = TileSchedule::Ordered;
+    RenderSettings costSettings = settings;
+    costSettings.tile_schedule = TileSchedule::CostFirst;
+
+    RayTracer ordered(orderedSettings);
+    RayTracer costFirst(costSettings);
+    // The second cost ordered render reuses the tile times of the first one
+    const std::pair<const char*, RayTracer*> runs[] = {
+            {"ordered", &ordered},
+            {"cost, probed", &costFirst},
+            {"cost, previous", &costFirst},
+    };
+
+    for (const auto& run : runs) {
+        // Time from the start of the render until each camera's image was complete
+        std::vector<double> cameraSeconds(scene->cameras.size());
+        auto start = std::chrono::steady_clock::now();
+        vector<RenderResult*> results = run.second->render(scene, [&](RenderResult* result, size_t camera) {
+            cameraSeconds[camera] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        });
+        deleteResults(results);
+
+        const RenderStats& stats = run.second->getStats();
+        double meanCameraSeconds = 0;
+        for (double seconds : cameraSeconds) {
+            meanCameraSeconds += seconds / cameraSeconds.size();
+        }
+        out << std::left << std::setw(20) << run.first << std::right
+            << std::setw(10) << stats.pass_seconds
+            << std::setw(10) << stats.tile_seconds / stats.thread_count
+            << std::setw(10) << (stats.pass_seconds > 0 ? 100.0 * stats.tile_seconds / (stats.pass_seconds * stats.thread_count) : 0.0)
+            << std::setw(12) << meanCameraSeconds << std::endl;
+    }
+
+    out.flags(flags);
+}
@@ -2,8 +2,12 @@
 #include "../../include/third_party/tinyxml2.h"
 #include "../../include/geometry/sphere.h"
 #include "../../include/geometry/triangle.h"
+#include "../../include/tools/plyReader.h"
 #include <sstream>
 #include <stdexcept>
+#include <sys/stat.h>
+
+Importer::Importer(unsigned int threadCount) : thread_count(threadCount) {}
 
 Scene Importer::importXml(const std::string &filepath)
 {
@@ -18,6 +22,11 @@ Scene Importer::importXml(const std::string &filepath)
         throw std::runtime_error("Error: The xml file cannot be loaded.");
     }
 
+    // The document holds the whole file until the scene is read, its node pools are not counted
+    struct stat fileInfo;
+    size_t documentBytes = stat(filepath.c_str(), &fileInfo) == 0 ? fileInfo.st_size : 0;
+    MemoryTracker::allocated(MemoryCategory::ParserBuffers, documentBytes);
+
     auto root = file.FirstChild();
     if (!root)
     {
@@ -179,6 +188,36 @@ Scene Importer::importXml(const std::string &filepath)
         stream >> mesh_material_id;
 
         child = element->FirstChildElement("Faces");
+
+        const char* plyFile = child->Attribute("plyFile");
+        if (plyFile)
+        {
+            std::string plyPath = plyFile;
+            size_t directoryEnd = filepath.find_last_of('/');
+            if (plyPath[0] != '/' && directoryEnd != std::string::npos)
+            {
+                plyPath = filepath.substr(0, directoryEnd + 1) + plyPath;
+            }
+
+            // Vertices go straight into the scene's vertex data, faces index into it
+            FaceBuffer faces;
+            PlyReader reader(thread_count);
+            reader.read(plyPath, scene.vertex_data, faces);
+
+            // The whole mesh goes into one block of the arena
+            scene.render_objects.reserve(scene.render_objects.size() + faces.size());
+            scene.arena.reserve(faces.size() * sizeof(Triangle));
+            for (const Face& face : faces)
+            {
+                auto* mesh_triangle = scene.arena.create<Triangle>(mesh_material_id - 1, scene.vertex_data[face.v0_id],
+                                                                   scene.vertex_data[face.v1_id], scene.vertex_data[face.v2_id]);
+                scene.render_objects.push_back(mesh_triangle);
+            }
+
+            element = element->NextSiblingElement("Mesh");
+            continue;
+        }
+
         stream << child->GetText() << std::endl;
 
         int v0id;
@@ -188,11 +227,8 @@ Scene Importer::importXml(const std::string &filepath)
 
             stream >> v1id >> v2id;
 
-            auto* mesh_triangle = new Triangle();
-            mesh_triangle->material_id = mesh_material_id - 1;
-            mesh_triangle->vertex_0 = scene.vertex_data[v0id - 1];
-            mesh_triangle->vertex_1 = scene.vertex_data[v1id - 1];
-            mesh_triangle->vertex_2 = scene.vertex_data[v2id - 1];
+            auto* mesh_triangle = scene.arena.create<Triangle>(mesh_material_id - 1, scene.vertex_data[v0id - 1],
+                                                               scene.vertex_data[v1id - 1], scene.vertex_data[v2id - 1]);
             scene.render_objects.push_back(mesh_triangle);
         }
         stream.clear();
@@ -204,7 +240,6 @@ Scene Importer::importXml(const std::string &filepath)
     //Get Triangles
     element = root->FirstChildElement("Objects");
     element = element->FirstChildElement("Triangle");
-    auto* triangle = new Triangle();
     while (element)
     {
         child = element->FirstChildElement("Material");
@@ -212,17 +247,15 @@ Scene Importer::importXml(const std::string &filepath)
 
         int matid;
         stream >> matid;
-        triangle->material_id = matid - 1;
 
         child = element->FirstChildElement("Indices");
         stream << child->GetText() << std::endl;
 
         int v0id, v1id, v2id;
         stream >> v0id >> v1id >> v2id;
-        triangle->vertex_0 = scene.vertex_data[v0id - 1];
-        triangle->vertex_1 = scene.vertex_data[v1id - 1];
-        triangle->vertex_2 = scene.vertex_data[v2id - 1];
 
+        auto* triangle = scene.arena.create<Triangle>(matid - 1, scene.vertex_data[v0id - 1],
+                                                      scene.vertex_data[v1id - 1], scene.vertex_data[v2id - 1]);
         scene.render_objects.push_back(triangle);
         element = element->NextSiblingElement("Triangle");
     }
@@ -231,16 +264,21 @@ Scene Importer::importXml(const std::string &filepath)
     element = root->FirstChildElement("Objects");
     element = element->FirstChildElement("Sphere");
 
-    while (element)
+    // Counted first, so that all spheres go into one block of the arena
+    size_t sphereCount = 0;
+    for (auto sibling = element; sibling; sibling = sibling->NextSiblingElement("Sphere"))
     {
-        auto* sphere = new Sphere();
+        sphereCount++;
+    }
+    scene.arena.reserve(sphereCount * sizeof(Sphere));
 
+    while (element)
+    {
         child = element->FirstChildElement("Material");
         stream << child->GetText() << std::endl;
 
         int matid;
         stream >> matid;
-        sphere->material_id = matid - 1;
 
         child = element->FirstChildElement("Center");
 
@@ -248,15 +286,17 @@ Scene Importer::importXml(const std::string &filepath)
 
         int centervid;
         stream >> centervid;
-        sphere->center_vertex = scene.vertex_data[centervid - 1];
 
         child = element->FirstChildElement("Radius");
         stream << child->GetText() << std::endl;
-        stream >> sphere->radius;
+        float radius;
+        stream >> radius;
 
+        auto* sphere = scene.arena.create<Sphere>(matid - 1, scene.vertex_data[centervid - 1], radius);
         scene.render_objects.push_back(sphere);
         element = element->NextSiblingElement("Sphere");
     }
 
+    MemoryTracker::released(MemoryCategory::ParserBuffers, documentBytes);
     return scene;
 }
@@ -0,0 +1,645 @@
+#include "../../include/tools/plyReader.h"
+#include "../../include/core/threadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Vertices of one ascii chunk, until they are appended to the scene
+using ChunkVertices = TrackedVector<Vec3f, MemoryCategory::ParserBuffers>;
+
+// Triangles of the faces of one chunk and the number of faces they came from
+struct ChunkFaces {
+    FaceBuffer triangles;
+    size_t face_count = 0;
+};
+
+enum class PlyType {
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+};
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyType::Float32;
+    // List properties store a count of count_type followed by that many values of type
+    bool is_list = false;
+    PlyType count_type = PlyType::UInt8;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+struct PlyHeader {
+    bool binary = false;
+    std::vector<PlyElement> elements;
+    // Offset of the first byte after end_header
+    size_t body_offset = 0;
+};
+
+// Which properties of the vertex and face elements the mesh is made of
+struct MeshLayout {
+    int vertex_element = -1;
+    int face_element = -1;
+    // Property index of x, y and z in the vertex element
+    int coordinate[3] = {-1, -1, -1};
+    // Property index of the vertex index list in the face element
+    int face_indices = -1;
+};
+
+// Read-only mapping of a whole file, pages are faulted in as the parser reaches them
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Error: The ply file " + path + " cannot be opened.");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("Error: The ply file " + path + " is empty.");
+        }
+        size = info.st_size;
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Error: The ply file " + path + " cannot be mapped.");
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+        MemoryTracker::allocated(MemoryCategory::ParserBuffers, size);
+    }
+
+    ~MappedFile() {
+        MemoryTracker::released(MemoryCategory::ParserBuffers, size);
+        munmap(const_cast<char*>(data), size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data;
+    size_t size;
+};
+
+bool parseType(const std::string& name, PlyType& type) {
+    static const struct {
+        const char* name;
+        PlyType type;
+    } types[] = {
+            {"char", PlyType::Int8}, {"int8", PlyType::Int8},
+            {"uchar", PlyType::UInt8}, {"uint8", PlyType::UInt8},
+            {"short", PlyType::Int16}, {"int16", PlyType::Int16},
+            {"ushort", PlyType::UInt16}, {"uint16", PlyType::UInt16},
+            {"int", PlyType::Int32}, {"int32", PlyType::Int32},
+            {"uint", PlyType::UInt32}, {"uint32", PlyType::UInt32},
+            {"float", PlyType::Float32}, {"float32", PlyType::Float32},
+            {"double", PlyType::Float64}, {"float64", PlyType::Float64},
+    };
+    for (const auto& candidate : types) {
+        if (name == candidate.name) {
+            type = candidate.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t typeSize(PlyType type) {
+    switch (type) {
+        case PlyType::Int8:
+        case PlyType::UInt8:
+            return 1;
+        case PlyType::Int16:
+        case PlyType::UInt16:
+            return 2;
+        case PlyType::Int32:
+        case PlyType::UInt32:
+        case PlyType::Float32:
+            return 4;
+        case PlyType::Float64:
+            return 8;
+    }
+    return 0;
+}
+
+template <class T>
+T loadValue(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// Binary value in host order, which the caller has checked to be little endian
+double readValue(const char* data, PlyType type) {
+    switch (type) {
+        case PlyType::Int8: return loadValue<int8_t>(data);
+        case PlyType::UInt8: return loadValue<uint8_t>(data);
+        case PlyType::Int16: return loadValue<int16_t>(data);
+        case PlyType::UInt16: return loadValue<uint16_t>(data);
+        case PlyType::Int32: return loadValue<int32_t>(data);
+        case PlyType::UInt32: return loadValue<uint32_t>(data);
+        case PlyType::Float32: return loadValue<float>(data);
+        case PlyType::Float64: return loadValue<double>(data);
+    }
+    return 0;
+}
+
+PlyHeader readHeader(const MappedFile& file, const std::string& path) {
+    PlyHeader header;
+    bool hasFormat = false;
+    size_t position = 0;
+    bool first = true;
+
+    while (true) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(file.data + position, '\n', file.size - position));
+        if (lineEnd == nullptr) {
+            throw std::runtime_error("Error: The ply file " + path + " has no end_header.");
+        }
+        std::string line(file.data + position, lineEnd);
+        position = lineEnd - file.data + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+
+        if (first) {
+            if (keyword != "ply") {
+                throw std::runtime_error("Error: " + path + " is not a ply file.");
+            }
+            first = false;
+        }
+        else if (keyword == "format") {
+            std::string format;
+            stream >> format;
+            if (format == "ascii") {
+                header.binary = false;
+            }
+            else if (format == "binary_little_endian") {
+                header.binary = true;
+            }
+            else {
+                throw std::runtime_error("Error: The ply format " + format + " of " + path + " is not supported.");
+            }
+            hasFormat = true;
+        }
+        else if (keyword == "element") {
+            PlyElement element;
+            if (!(stream >> element.name >> element.count)) {
+                throw std::runtime_error("Error: Malformed element in the ply file " + path + ".");
+            }
+            header.elements.push_back(element);
+        }
+        else if (keyword == "property") {
+            if (header.elements.empty()) {
+                throw std::runtime_error("Error: Property before any element in the ply file " + path + ".");
+            }
+            PlyProperty property;
+            std::string type;
+            stream >> type;
+            if (type == "list") {
+                std::string countType;
+                stream >> countType >> type;
+                property.is_list = true;
+                if (!parseType(countType, property.count_type)) {
+                    throw std::runtime_error("Error: Unknown ply type " + countType + " in " + path + ".");
+                }
+            }
+            if (!parseType(type, property.type)) {
+                throw std::runtime_error("Error: Unknown ply type " + type + " in " + path + ".");
+            }
+            stream >> property.name;
+            header.elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header") {
+            break;
+        }
+        else if (keyword != "comment" && keyword != "obj_info" && !keyword.empty()) {
+            throw std::runtime_error("Error: Unknown ply header line \"" + line + "\" in " + path + ".");
+        }
+    }
+
+    if (!hasFormat) {
+        throw std::runtime_error("Error: The ply file " + path + " has no format.");
+    }
+    header.body_offset = position;
+    return header;
+}
+
+MeshLayout findMesh(const PlyHeader& header, const std::string& path) {
+    MeshLayout layout;
+    for (size_t e = 0; e < header.elements.size(); e++) {
+        const PlyElement& element = header.elements[e];
+        for (size_t p = 0; p < element.properties.size(); p++) {
+            const PlyProperty& property = element.properties[p];
+            if (element.name == "vertex" && !property.is_list && property.name.size() == 1 &&
+                property.name[0] >= 'x' && property.name[0] <= 'z') {
+                layout.vertex_element = e;
+                layout.coordinate[property.name[0] - 'x'] = p;
+            }
+            if (element.name == "face" && property.is_list &&
+                (property.name == "vertex_indices" || property.name == "vertex_index")) {
+                layout.face_element = e;
+                layout.face_indices = p;
+            }
+        }
+    }
+
+    if (layout.coordinate[0] < 0 || layout.coordinate[1] < 0 || layout.coordinate[2] < 0) {
+        throw std::runtime_error("Error: The ply file " + path + " has no vertex positions.");
+    }
+    if (layout.face_element < 0) {
+        throw std::runtime_error("Error: The ply file " + path + " has no faces.");
+    }
+    return layout;
+}
+
+// Collects the triangles of one polygon as a fan around its first vertex
+class FanBuilder {
+public:
+    FanBuilder(FaceBuffer& faces, size_t vertexBase, size_t vertexCount, const std::string& path)
+            : faces(faces), vertex_base(vertexBase), vertex_count(vertexCount), path(path) {}
+
+    void begin() {
+        corner = 0;
+    }
+
+    void add(long long index) {
+        if (index < 0 || (size_t)index >= vertex_count) {
+            throw std::runtime_error("Error: Vertex index out of range in the ply file " + path + ".");
+        }
+        int vertex = (int)(vertex_base + index);
+        if (corner == 0) {
+            first = vertex;
+        }
+        else if (corner >= 2) {
+            faces.push_back({first, previous, vertex});
+        }
+        previous = vertex;
+        corner++;
+    }
+
+private:
+    FaceBuffer& faces;
+    size_t vertex_base;
+    size_t vertex_count;
+    const std::string& path;
+    size_t corner = 0;
+    int first = 0;
+    int previous = 0;
+};
+
+class BinaryCursor {
+public:
+    BinaryCursor(const char* begin, const char* end, const std::string& path) : position(begin), end(end), path(path) {}
+
+    const char* take(size_t size) {
+        if ((size_t)(end - position) < size) {
+            throw std::runtime_error("Error: The ply file " + path + " is truncated.");
+        }
+        const char* data = position;
+        position += size;
+        return data;
+    }
+
+    size_t remaining() const {
+        return end - position;
+    }
+
+    // Number of records of recordSize bytes in the rest of the file, checked before anything is allocated
+    // for them. The count comes from the file, multiplying it first could wrap around.
+    void expect(size_t count, size_t recordSize) const {
+        if (count > remaining() / std::max<size_t>(recordSize, 1)) {
+            throw std::runtime_error("Error: The ply file " + path + " is truncated.");
+        }
+    }
+
+    // Length of a list, which must be a whole number of values that fit into the rest of the file
+    size_t listCount(PlyType type, size_t valueSize) {
+        double count = readValue(take(typeSize(type)), type);
+        if (!(count >= 0) || count != std::floor(count)) {
+            throw std::runtime_error("Error: Malformed list length in the ply file " + path + ".");
+        }
+        if (count > (double)(remaining() / std::max<size_t>(valueSize, 1))) {
+            throw std::runtime_error("Error: The ply file " + path + " is truncated.");
+        }
+        return (size_t)count;
+    }
+
+private:
+    const char* position;
+    const char* end;
+    const std::string& path;
+};
+
+void readBinary(const MappedFile& file, const PlyHeader& header, const MeshLayout& layout, const std::string& path,
+                VertexBuffer& vertices, FaceBuffer& faces) {
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    throw std::runtime_error("Error: Binary ply files are only supported on little endian machines.");
+#endif
+    size_t vertexBase = vertices.size();
+    size_t vertexCount = header.elements[layout.vertex_element].count;
+    BinaryCursor cursor(file.data + header.body_offset, file.data + file.size, path);
+
+    for (size_t e = 0; e < header.elements.size(); e++) {
+        const PlyElement& element = header.elements[e];
+        bool isVertex = (int)e == layout.vertex_element;
+        bool isFace = (int)e == layout.face_element;
+
+        // Vertices without list properties have a fixed stride and are decoded without walking every property
+        size_t stride = 0;
+        size_t offset[3] = {0, 0, 0};
+        bool fixedStride = true;
+        // Bytes of a record whose lists are all empty
+        size_t minimumRecordSize = 0;
+        for (size_t p = 0; p < element.properties.size(); p++) {
+            const PlyProperty& property = element.properties[p];
+            fixedStride = fixedStride && !property.is_list;
+            for (int axis = 0; axis < 3; axis++) {
+                if (isVertex && (int)p == layout.coordinate[axis]) {
+                    offset[axis] = stride;
+                }
+            }
+            stride += typeSize(property.type);
+            minimumRecordSize += typeSize(property.is_list ? property.count_type : property.type);
+        }
+        cursor.expect(element.count, minimumRecordSize);
+
+        if (fixedStride) {
+            const char* records = cursor.take(element.count * stride);
+            if (isVertex) {
+                const PlyProperty* properties[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    properties[axis] = &element.properties[layout.coordinate[axis]];
+                }
+                vertices.resize(vertexBase + element.count);
+                for (size_t i = 0; i < element.count; i++) {
+                    const char* record = records + i * stride;
+                    vertices[vertexBase + i] = Vec3f(readValue(record + offset[0], properties[0]->type),
+                                                     readValue(record + offset[1], properties[1]->type),
+                                                     readValue(record + offset[2], properties[2]->type));
+                }
+            }
+            continue;
+        }
+
+        if (isFace) {
+            faces.reserve(faces.size() + element.count);
+        }
+        FanBuilder fan(faces, vertexBase, vertexCount, path);
+        for (size_t i = 0; i < element.count; i++) {
+            float position[3] = {0, 0, 0};
+            for (size_t p = 0; p < element.properties.size(); p++) {
+                const PlyProperty& property = element.properties[p];
+                size_t size = typeSize(property.type);
+                if (!property.is_list) {
+                    const char* value = cursor.take(size);
+                    for (int axis = 0; axis < 3; axis++) {
+                        if (isVertex && (int)p == layout.coordinate[axis]) {
+                            position[axis] = readValue(value, property.type);
+                        }
+                    }
+                    continue;
+                }
+
+                size_t count = cursor.listCount(property.count_type, size);
+                const char* values = cursor.take(count * size);
+                if (isFace && (int)p == layout.face_indices) {
+                    fan.begin();
+                    for (size_t k = 0; k < count; k++) {
+                        fan.add((long long)readValue(values + k * size, property.type));
+                    }
+                }
+            }
+            if (isVertex) {
+                vertices.push_back(Vec3f(position[0], position[1], position[2]));
+            }
+        }
+    }
+}
+
+// Whitespace separated numbers of an ascii body, never reads past end
+class AsciiCursor {
+public:
+    AsciiCursor(const char* begin, const char* end, const std::string& path) : position(begin), end(end), path(path) {}
+
+    bool atEnd() {
+        skipWhitespace();
+        return position >= end;
+    }
+
+    template <class T>
+    T next() {
+        skipWhitespace();
+        T value{};
+        std::from_chars_result result = std::from_chars(position, end, value);
+        if (result.ec != std::errc()) {
+            throw std::runtime_error("Error: Malformed number in the ply file " + path + ".");
+        }
+        position = result.ptr;
+        return value;
+    }
+
+    long long listCount() {
+        long long count = next<long long>();
+        bool fraction = position < end && (*position == '.' || *position == 'e' || *position == 'E');
+        if (count < 0 || fraction) {
+            throw std::runtime_error("Error: Malformed list length in the ply file " + path + ".");
+        }
+        return count;
+    }
+
+private:
+    void skipWhitespace() {
+        while (position < end && (*position == ' ' || *position == '\t' || *position == '\r' || *position == '\n')) {
+            position++;
+        }
+    }
+
+    const char* position;
+    const char* end;
+    const std::string& path;
+};
+
+// Start of the line count lines after begin
+const char* skipLines(const char* begin, const char* end, size_t count, const std::string& path) {
+    for (size_t i = 0; i < count; i++) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (lineEnd == nullptr) {
+            if (i + 1 == count && begin < end) {
+                return end;
+            }
+            throw std::runtime_error("Error: The ply file " + path + " is truncated.");
+        }
+        begin = lineEnd + 1;
+    }
+    return begin;
+}
+
+// Splits [begin, end) into about chunkCount pieces that start and end on line boundaries
+std::vector<std::pair<const char*, const char*>> splitLines(const char* begin, const char* end, size_t chunkCount) {
+    std::vector<std::pair<const char*, const char*>> chunks;
+    size_t chunkSize = (end - begin) / chunkCount + 1;
+    while (begin < end) {
+        const char* chunkEnd = begin + std::min(chunkSize, (size_t)(end - begin));
+        if (chunkEnd < end) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = lineEnd != nullptr ? lineEnd + 1 : end;
+        }
+        chunks.emplace_back(begin, chunkEnd);
+        begin = chunkEnd;
+    }
+    return chunks;
+}
+
+ChunkVertices parseVertices(AsciiCursor cursor, const PlyElement& element, const MeshLayout& layout) {
+    ChunkVertices vertices;
+    while (!cursor.atEnd()) {
+        float position[3] = {0, 0, 0};
+        for (size_t p = 0; p < element.properties.size(); p++) {
+            if (element.properties[p].is_list) {
+                long long count = cursor.listCount();
+                for (long long k = 0; k < count; k++) {
+                    cursor.next<double>();
+                }
+                continue;
+            }
+            bool isCoordinate = false;
+            for (int axis = 0; axis < 3; axis++) {
+                if ((int)p == layout.coordinate[axis]) {
+                    position[axis] = cursor.next<float>();
+                    isCoordinate = true;
+                }
+            }
+            if (!isCoordinate) {
+                cursor.next<double>();
+            }
+        }
+        vertices.push_back(Vec3f(position[0], position[1], position[2]));
+    }
+    return vertices;
+}
+
+ChunkFaces parseFaces(AsciiCursor cursor, const PlyElement& element, const MeshLayout& layout,
+                      size_t vertexBase, size_t vertexCount, const std::string& path) {
+    ChunkFaces faces;
+    FanBuilder fan(faces.triangles, vertexBase, vertexCount, path);
+    while (!cursor.atEnd()) {
+        faces.face_count++;
+        for (size_t p = 0; p < element.properties.size(); p++) {
+            if (!element.properties[p].is_list) {
+                cursor.next<double>();
+                continue;
+            }
+            long long count = cursor.listCount();
+            bool isIndices = (int)p == layout.face_indices;
+            fan.begin();
+            for (long long k = 0; k < count; k++) {
+                if (isIndices) {
+                    fan.add(cursor.next<long long>());
+                }
+                else {
+                    cursor.next<double>();
+                }
+            }
+        }
+    }
+    return faces;
+}
+
+void readAscii(const MappedFile& file, const PlyHeader& header, const MeshLayout& layout, const std::string& path,
+               unsigned int threadCount, VertexBuffer& vertices, FaceBuffer& faces) {
+    size_t vertexBase = vertices.size();
+    size_t vertexCount = header.elements[layout.vertex_element].count;
+    const char* position = file.data + header.body_offset;
+    const char* end = file.data + file.size;
+
+    // Finding the line boundaries is cheap next to parsing the numbers, which is spread over the workers
+    ThreadPool threadPool(threadCount);
+    size_t chunkCount = threadCount * 4;
+
+    for (size_t e = 0; e < header.elements.size(); e++) {
+        const PlyElement& element = header.elements[e];
+        const char* sectionEnd = skipLines(position, end, element.count, path);
+        std::vector<std::pair<const char*, const char*>> chunks = splitLines(position, sectionEnd, chunkCount);
+        position = sectionEnd;
+
+        if ((int)e == layout.vertex_element) {
+            std::vector<std::future<ChunkVertices>> parsed;
+            for (const auto& chunk : chunks) {
+                parsed.push_back(threadPool.enqueue([&element, &layout, &path, chunk] {
+                    return parseVertices(AsciiCursor(chunk.first, chunk.second, path), element, layout);
+                }));
+            }
+            vertices.reserve(vertexBase + element.count);
+            for (auto& chunk : parsed) {
+                ChunkVertices chunkVertices = chunk.get();
+                vertices.insert(vertices.end(), chunkVertices.begin(), chunkVertices.end());
+            }
+            if (vertices.size() - vertexBase != element.count) {
+                throw std::runtime_error("Error: The vertex count of the ply file " + path + " does not match its header.");
+            }
+        }
+        else if ((int)e == layout.face_element) {
+            std::vector<std::future<ChunkFaces>> parsed;
+            for (const auto& chunk : chunks) {
+                parsed.push_back(threadPool.enqueue([&element, &layout, &path, chunk, vertexBase, vertexCount] {
+                    return parseFaces(AsciiCursor(chunk.first, chunk.second, path), element, layout,
+                                      vertexBase, vertexCount, path);
+                }));
+            }
+            faces.reserve(faces.size() + element.count);
+            size_t faceCount = 0;
+            for (auto& chunk : parsed) {
+                ChunkFaces chunkFaces = chunk.get();
+                faces.insert(faces.end(), chunkFaces.triangles.begin(), chunkFaces.triangles.end());
+                faceCount += chunkFaces.face_count;
+            }
+            // Blank or joined lines pass the line count, but leave fewer faces than the header promises
+            if (faceCount < element.count) {
+                throw std::runtime_error("Error: The ply file " + path + " is truncated.");
+            }
+            if (faceCount != element.count) {
+                throw std::runtime_error("Error: The face count of the ply file " + path + " does not match its header.");
+            }
+        }
+    }
+}
+
+}
+
+PlyReader::PlyReader(unsigned int threadCount) : thread_count(std::max(1u, threadCount)) {}
+
+void PlyReader::read(const std::string& path, VertexBuffer& vertices, FaceBuffer& faces) const {
+    MappedFile file(path);
+    PlyHeader header = readHeader(file, path);
+    MeshLayout layout = findMesh(header, path);
+
+    if (header.binary) {
+        readBinary(file, header, layout, path, vertices, faces);
+    }
+    else {
+        readAscii(file, header, layout, path, thread_count, vertices, faces);
+    }
+}
@@ -0,0 +1,518 @@
+#include "../../include/tools/regression.h"
+#include "../../include/tools/importer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+struct Baseline {
+    // Throughputs of different thread counts cannot be compared, zero when the file names none
+    unsigned int thread_count = 0;
+    // Mpixel/s by scene and path
+    std::map<std::pair<std::string, std::string>, double> throughput;
+};
+
+// A line of "threads <count>" and lines of "<Mpixel/s> <path> <scene>", the scene last since file names
+// may contain spaces
+bool readBaseline(const std::string& path, Baseline& baseline) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream stream(line);
+        if (line.compare(0, 8, "threads ") == 0) {
+            std::string keyword;
+            if (!(stream >> keyword >> baseline.thread_count) || baseline.thread_count == 0) {
+                throw std::runtime_error("Error: Malformed line \"" + line + "\" in the baseline " + path + ".");
+            }
+            continue;
+        }
+        double throughput;
+        std::string renderPath, scene;
+        if (!(stream >> throughput >> renderPath >> std::ws) || !std::getline(stream, scene) || scene.empty()) {
+            throw std::runtime_error("Error: Malformed line \"" + line + "\" in the baseline " + path + ".");
+        }
+        baseline.throughput[{scene, renderPath}] = throughput;
+    }
+    return true;
+}
+
+void writeBaseline(const std::string& path, const Baseline& baseline) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Error: The baseline " + path + " cannot be written.");
+    }
+    file << "# Mpixel/s, render path, scene" << std::endl;
+    file << "threads " << baseline.thread_count << std::endl;
+    file << std::fixed << std::setprecision(4);
+    for (const auto& entry : baseline.throughput) {
+        file << entry.second << " " << entry.first.second << " " << entry.first.first << std::endl;
+    }
+}
+
+struct ImageDifference {
+    int max_difference = 0;
+    // Pixels with a channel further from the reference than the tolerance
+    uint64_t failed_pixels = 0;
+};
+
+ImageDifference compareImages(const vector<RenderResult*>& reference, const vector<RenderResult*>& results, int tolerance) {
+    ImageDifference difference;
+    for (size_t i = 0; i < reference.size(); i++) {
+        for (int p = 0; p < reference[i]->width * reference[i]->height; p++) {
+            const Color& a = reference[i]->image[p];
+            const Color& b = results[i]->image[p];
+            int pixel = std::max({std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b)});
+            difference.max_difference = std::max(difference.max_difference, pixel);
+            if (pixel > tolerance) {
+                difference.failed_pixels++;
+            }
+        }
+    }
+    return difference;
+}
+
+void deleteResults(vector<RenderResult*>& results) {
+    for (RenderResult* result : results) {
+        delete result;
+    }
+    results.clear();
+}
+
+// Writes the text of one xml element per line, so the files stay readable
+class SceneWriter {
+public:
+    explicit SceneWriter(const std::string& path) : file(path) {
+        if (!file) {
+            throw std::runtime_error("Error: The scene " + path + " cannot be written.");
+        }
+        file << "<Scene>" << std::endl;
+        file << "    <BackgroundColor>20 30 40</BackgroundColor>" << std::endl;
+        file << "    <ShadowRayEpsilon>1e-3</ShadowRayEpsilon>" << std::endl;
+        file << "    <MaxRecursionDepth>3</MaxRecursionDepth>" << std::endl;
+    }
+
+    ~SceneWriter() {
+        file << "</Scene>" << std::endl;
+    }
+
+    // Looks along gaze with up made orthogonal to it
+    void camera(const Vec3f& position, const Vec3f& gaze, const char* imageName) {
+        Vec3f w = gaze.normalized();
+        Vec3f up = Vec3f(0, 1, 0) - w * w.y;
+        file << "        <Camera>" << std::endl;
+        file << "            <Position>" << position.x << " " << position.y << " " << position.z << "</Position>" << std::endl;
+        file << "            <Gaze>" << w.x << " " << w.y << " " << w.z << "</Gaze>" << std::endl;
+        file << "            <Up>" << up.x << " " << up.y << " " << up.z << "</Up>" << std::endl;
+        file << "            <NearPlane>-1 1 -0.75 0.75</NearPlane>" << std::endl;
+        file << "            <NearDistance>1.5</NearDistance>" << std::endl;
+        file << "            <ImageResolution>320 240</ImageResolution>" << std::endl;
+        file << "            <ImageName>" << imageName << "</ImageName>" << std::endl;
+        file << "        </Camera>" << std::endl;
+    }
+
+    // A diffuse floor, a shiny red, a mirror and a blue material, ids 1 to 4
+    void lightsAndMaterials() {
+        file << "    <Lights>" << std::endl;
+        file << "        <AmbientLight>25 25 25</AmbientLight>" << std::endl;
+        file << "        <PointLight><Position>-6 10 6</Position><Intensity>60000 60000 60000</Intensity></PointLight>" << std::endl;
+        file << "        <PointLight><Position>8 6 -4</Position><Intensity>40000 38000 36000</Intensity></PointLight>" << std::endl;
+        file << "    </Lights>" << std::endl;
+        file << "    <Materials>" << std::endl;
+        material(false, "0.1 0.1 0.1", "0.5 0.5 0.5", "0 0 0", "0 0 0", 1);
+        material(false, "0.1 0 0", "0.7 0.1 0.1", "0.9 0.9 0.9", "0 0 0", 50);
+        material(true, "0 0 0", "0.1 0.1 0.1", "0.5 0.5 0.5", "0.8 0.8 0.8", 100);
+        material(false, "0 0 0.1", "0.1 0.2 0.7", "0.4 0.4 0.4", "0 0 0", 20);
+        file << "    </Materials>" << std::endl;
+    }
+
+    void vertices(const std::vector<Vec3f>& vertices) {
+        file << "    <VertexData>" << std::endl;
+        for (const Vec3f& vertex : vertices) {
+            file << "        " << vertex.x << " " << vertex.y << " " << vertex.z << std::endl;
+        }
+        file << "    </VertexData>" << std::endl;
+    }
+
+    std::ofstream file;
+
+private:
+    void material(bool mirror, const char* ambient, const char* diffuse, const char* specular, const char* mirrorReflectance, int phong) {
+        file << "        <Material" << (mirror ? " type=\"mirror\"" : "") << ">" << std::endl;
+        file << "            <AmbientReflectance>" << ambient << "</AmbientReflectance>" << std::endl;
+        file << "            <DiffuseReflectance>" << diffuse << "</DiffuseReflectance>" << std::endl;
+        file << "            <SpecularReflectance>" << specular << "</SpecularReflectance>" << std::endl;
+        file << "            <MirrorReflectance>" << mirrorReflectance << "</MirrorReflectance>" << std::endl;
+        file << "            <PhongExponent>" << phong << "</PhongExponent>" << std::endl;
+        file << "        </Material>" << std::endl;
+    }
+};
+
+// A floor of two triangles around the origin, vertices 1 to 4 of the scene
+void floorVertices(std::vector<Vec3f>& vertices) {
+    vertices.push_back(Vec3f(-20, 0, -20));
+    vertices.push_back(Vec3f(-20, 0, 20));
+    vertices.push_back(Vec3f(20, 0, 20));
+    vertices.push_back(Vec3f(20, 0, -20));
+}
+
+void floorTriangles(SceneWriter& writer) {
+    writer.file << "        <Triangle><Material>1</Material><Indices>1 2 3</Indices></Triangle>" << std::endl;
+    writer.file << "        <Triangle><Material>1</Material><Indices>1 3 4</Indices></Triangle>" << std::endl;
+}
+
+// Sphere elements on a floor of triangle elements, seen by two cameras
+void writeSpheres(const std::string& path) {
+    std::vector<Vec3f> vertices;
+    floorVertices(vertices);
+    std::vector<float> radii;
+    // A fixed linear congruential sequence, the scene is the same on every platform
+    uint32_t random = 12345;
+    auto next = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return (random >> 8) / float(1 << 24);
+    };
+    for (int z = 0; z < 14; z++) {
+        for (int x = 0; x < 14; x++) {
+            float radius = 0.25f + 0.2f * next();
+            vertices.push_back(Vec3f(-7 + x + 0.4f * next(), radius, -10 + z + 0.4f * next()));
+            radii.push_back(radius);
+        }
+    }
+
+    SceneWriter writer(path);
+    writer.file << "    <Cameras>" << std::endl;
+    writer.camera(Vec3f(0, 4, 9), Vec3f(0, -0.4f, -1), "spheres_front.ppm");
+    writer.camera(Vec3f(11, 3, -3), Vec3f(-1, -0.3f, 0), "spheres_side.ppm");
+    writer.file << "    </Cameras>" << std::endl;
+    writer.lightsAndMaterials();
+    writer.vertices(vertices);
+    writer.file << "    <Objects>" << std::endl;
+    floorTriangles(writer);
+    for (size_t i = 0; i < radii.size(); i++) {
+        writer.file << "        <Sphere><Material>" << 2 + i % 3 << "</Material><Center>" << i + 5
+                    << "</Center><Radius>" << radii[i] << "</Radius></Sphere>" << std::endl;
+    }
+    writer.file << "    </Objects>" << std::endl;
+}
+
+// A height field as an inline mesh under a mirror sphere
+void writeTerrain(const std::string& path) {
+    const int cells = 48;
+    std::vector<Vec3f> vertices;
+    for (int z = 0; z <= cells; z++) {
+        for (int x = 0; x <= cells; x++) {
+            float px = -10 + 20.0f * x / cells;
+            float pz = -14 + 20.0f * z / cells;
+            float height = 1.2f * std::sin(0.7f * px) * std::cos(0.5f * pz) + 0.3f * std::sin(2.1f * px + 1.3f * pz);
+            vertices.push_back(Vec3f(px, height, pz));
+        }
+    }
+    vertices.push_back(Vec3f(0, 3, -5));
+
+    SceneWriter writer(path);
+    writer.file << "    <Cameras>" << std::endl;
+    writer.camera(Vec3f(0, 6, 8), Vec3f(0, -0.5f, -1), "terrain.ppm");
+    writer.file << "    </Cameras>" << std::endl;
+    writer.lightsAndMaterials();
+    writer.vertices(vertices);
+    writer.file << "    <Objects>" << std::endl;
+    writer.file << "        <Mesh>" << std::endl;
+    writer.file << "            <Material>4</Material>" << std::endl;
+    writer.file << "            <Faces>" << std::endl;
+    for (int z = 0; z < cells; z++) {
+        for (int x = 0; x < cells; x++) {
+            int corner = z * (cells + 1) + x + 1;
+            writer.file << "                " << corner << " " << corner + cells + 1 << " " << corner + 1 << std::endl;
+            writer.file << "                " << corner + 1 << " " << corner + cells + 1 << " " << corner + cells + 2 << std::endl;
+        }
+    }
+    writer.file << "            </Faces>" << std::endl;
+    writer.file << "        </Mesh>" << std::endl;
+    writer.file << "        <Sphere><Material>3</Material><Center>" << vertices.size() << "</Center><Radius>1.5</Radius></Sphere>" << std::endl;
+    writer.file << "    </Objects>" << std::endl;
+}
+
+// A sphere of quads in an ascii file, the faces are fan triangulated by the reader
+void writeAsciiPly(const std::string& path, const Vec3f& center, float radius) {
+    const int segments = 32;
+    const int rings = 16;
+    std::ofstream file(path);
+    file << "ply" << std::endl;
+    file << "format ascii 1.0" << std::endl;
+    file << "element vertex " << segments * (rings - 1) + 2 << std::endl;
+    file << "property float x" << std::endl << "property float y" << std::endl << "property float z" << std::endl;
+    file << "element face " << segments * rings << std::endl;
+    file << "property list uchar int vertex_indices" << std::endl;
+    file << "end_header" << std::endl;
+
+    file << center.x << " " << center.y + radius << " " << center.z << std::endl;
+    for (int ring = 1; ring < rings; ring++) {
+        float theta = float(M_PI) * ring / rings;
+        for (int segment = 0; segment < segments; segment++) {
+            float phi = 2 * float(M_PI) * segment / segments;
+            file << center.x + radius * std::sin(theta) * std::cos(phi) << " " << center.y + radius * std::cos(theta)
+                 << " " << center.z + radius * std::sin(theta) * std::sin(phi) << std::endl;
+        }
+    }
+    file << center.x << " " << center.y - radius << " " << center.z << std::endl;
+
+    int bottom = segments * (rings - 1) + 1;
+    auto ringVertex = [&](int ring, int segment) { return 1 + (ring - 1) * segments + segment % segments; };
+    for (int segment = 0; segment < segments; segment++) {
+        file << "3 0 " << ringVertex(1, segment + 1) << " " << ringVertex(1, segment) << std::endl;
+        for (int ring = 1; ring < rings - 1; ring++) {
+            file << "4 " << ringVertex(ring, segment) << " " << ringVertex(ring, segment + 1) << " "
+                 << ringVertex(ring + 1, segment + 1) << " " << ringVertex(ring + 1, segment) << std::endl;
+        }
+        file << "3 " << ringVertex(rings - 1, segment) << " " << ringVertex(rings - 1, segment + 1) << " " << bottom << std::endl;
+    }
+}
+
+// A torus of triangles in a binary little endian file
+void writeBinaryPly(const std::string& path, const Vec3f& center, float majorRadius, float minorRadius) {
+    const int segments = 64;
+    const int sides = 24;
+    std::ofstream file(path, std::ios::binary);
+    file << "ply\n";
+    file << "format binary_little_endian 1.0\n";
+    file << "element vertex " << segments * sides << "\n";
+    file << "property float x\nproperty float y\nproperty float z\n";
+    file << "element face " << 2 * segments * sides << "\n";
+    file << "property list uchar int vertex_indices\n";
+    file << "end_header\n";
+
+    for (int segment = 0; segment < segments; segment++) {
+        float phi = 2 * float(M_PI) * segment / segments;
+        for (int side = 0; side < sides; side++) {
+            float theta = 2 * float(M_PI) * side / sides;
+            float distance = majorRadius + minorRadius * std::cos(theta);
+            float position[3] = {center.x + distance * std::cos(phi), center.y + minorRadius * std::sin(theta),
+                                 center.z + distance * std::sin(phi)};
+            file.write(reinterpret_cast<const char*>(position), sizeof(position));
+        }
+    }
+    auto vertex = [&](int segment, int side) { return int32_t((segment % segments) * sides + side % sides); };
+    auto face = [&file](int32_t a, int32_t b, int32_t c) {
+        uint8_t count = 3;
+        int32_t indices[3] = {a, b, c};
+        file.write(reinterpret_cast<const char*>(&count), 1);
+        file.write(reinterpret_cast<const char*>(indices), sizeof(indices));
+    };
+    for (int segment = 0; segment < segments; segment++) {
+        for (int side = 0; side < sides; side++) {
+            face(vertex(segment, side), vertex(segment, side + 1), vertex(segment + 1, side + 1));
+            face(vertex(segment, side), vertex(segment + 1, side + 1), vertex(segment + 1, side));
+        }
+    }
+}
+
+// Meshes from an ascii and a binary PLY file next to triangle elements
+void writePlyMeshes(const std::string& directory, const std::string& path) {
+    writeAsciiPly(directory + "/sphere_ascii.ply", Vec3f(-2.5f, 1.5f, -3), 1.5f);
+    writeBinaryPly(directory + "/torus_binary.ply", Vec3f(2.5f, 1.2f, -3), 1.5f, 0.5f);
+
+    std::vector<Vec3f> vertices;
+    floorVertices(vertices);
+
+    SceneWriter writer(path);
+    writer.file << "    <Cameras>" << std::endl;
+    writer.camera(Vec3f(0, 4, 6), Vec3f(0, -0.35f, -1), "ply_meshes.ppm");
+    writer.file << "    </Cameras>" << std::endl;
+    writer.lightsAndMaterials();
+    writer.vertices(vertices);
+    writer.file << "    <Objects>" << std::endl;
+    writer.file << "        <Mesh><Material>2</Material><Faces plyFile=\"sphere_ascii.ply\"/></Mesh>" << std::endl;
+    writer.file << "        <Mesh><Material>3</Material><Faces plyFile=\"torus_binary.ply\"/></Mesh>" << std::endl;
+    floorTriangles(writer);
+    writer.file << "    </Objects>" << std::endl;
+}
+
+}
+
+std::vector<RenderPath> RegressionHarness::renderPaths(const RenderSettings& settings) {
+    RenderSettings reference = settings;
+    // Every path renders the complete image
+    reference.deadline_seconds = 0;
+    reference.acceleration = AccelerationKind::Linear;
+    reference.bvh_layout = BvhLayout::Binary;
+    reference.tile_order = TileOrder::Scanline;
+    reference.tile_schedule = TileSchedule::Ordered;
+    reference.tile_culling = false;
+    reference.primary_visibility = PrimaryVisibility::RayTraced;
+    reference.thread_placement = ThreadPlacement::None;
+    reference.replicate_scene = false;
+
+    std::vector<RenderPath> paths;
+    paths.push_back({"reference", reference, false});
+
+    RenderPath grid{"grid", reference, false};
+    grid.settings.acceleration = AccelerationKind::Grid;
+    paths.push_back(grid);
+
+    // The remaining paths each turn on one optimization over the plain hierarchy
+    RenderSettings bvh = reference;
+    bvh.acceleration = AccelerationKind::Bvh;
+    paths.push_back({"bvh", bvh, false});
+
+    RenderPath compressed{"bvh-compressed", bvh, false};
+    compressed.settings.bvh_layout = BvhLayout::Compressed;
+    paths.push_back(compressed);
+
+    RenderPath tileOrder{"tile-order", bvh, false};
+    tileOrder.settings.tile_order = settings.tile_order == TileOrder::Scanline ? TileOrder::Hilbert : settings.tile_order;
+    paths.push_back(tileOrder);
+
+    RenderPath schedule{"cost-schedule", bvh, false};
+    schedule.settings.tile_schedule = TileSchedule::CostFirst;
+    paths.push_back(schedule);
+
+    RenderPath culling{"tile-culling", bvh, false};
+    culling.settings.tile_culling = true;
+    paths.push_back(culling);
+
+    RenderPath raster{"raster", bvh, false};
+    raster.settings.primary_visibility = PrimaryVisibility::Rasterized;
+    paths.push_back(raster);
+
+    RenderPath replicated{"replicate", bvh, false};
+    replicated.settings.thread_placement = ThreadPlacement::NumaNodes;
+    replicated.settings.replicate_scene = true;
+    paths.push_back(replicated);
+
+    paths.push_back({"progressive", bvh, true});
+    return paths;
+}
+
+std::vector<std::string> RegressionHarness::writeCorpus(const std::string& directory) {
+    std::vector<std::string> paths = {directory + "/spheres.xml", directory + "/terrain.xml", directory + "/ply_meshes.xml"};
+    writeSpheres(paths[0]);
+    writeTerrain(paths[1]);
+    writePlyMeshes(directory, paths[2]);
+    return paths;
+}
+
+bool RegressionHarness::run(const RegressionSettings& regression, const RenderSettings& settings, std::ostream& out) const {
+    std::vector<std::string> scenePaths = regression.scene_paths;
+    std::string corpusDirectory;
+    if (scenePaths.empty()) {
+        char directory[] = "/tmp/raytracer-regression-XXXXXX";
+        if (mkdtemp(directory) == nullptr) {
+            throw std::runtime_error("Error: No directory for the regression scenes can be created.");
+        }
+        corpusDirectory = directory;
+        scenePaths = writeCorpus(corpusDirectory);
+    }
+
+    Baseline baseline;
+    bool checkBaseline = readBaseline(regression.baseline_path, baseline) && !regression.update_baseline;
+    unsigned int threadCount = std::max(1u, settings.thread_count);
+    if (checkBaseline && baseline.thread_count != threadCount) {
+        throw std::runtime_error("Error: The baseline " + regression.baseline_path + " was measured with " +
+                                 (baseline.thread_count == 0 ? std::string("an unknown number of") : std::to_string(baseline.thread_count)) +
+                                 " threads, not " + std::to_string(threadCount) + ". Pass the same --threads or --update-baseline.");
+    }
+    // Entries of other scenes are kept, unless they were measured with other threads
+    Baseline measured = baseline.thread_count == threadCount ? baseline : Baseline();
+    measured.thread_count = threadCount;
+    std::vector<RenderPath> paths = renderPaths(settings);
+    int failures = 0;
+
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+
+    for (const std::string& scenePath : scenePaths) {
+        // The built-in scenes are named by their file, they are written to a new directory every time
+        std::string sceneName = corpusDirectory.empty() ? scenePath : scenePath.substr(scenePath.find_last_of('/') + 1);
+        Importer importer(settings.thread_count);
+        auto scene = std::make_shared<const Scene>(importer.importXml(scenePath));
+
+        double pixels = 0;
+        for (const Camera& camera : scene->cameras) {
+            pixels += (double)camera.image_width * camera.image_height;
+        }
+        out << sceneName << ": " << scene->render_objects.size() << " objects, " << scene->cameras.size() << " cameras" << std::endl;
+        out << std::left << std::setw(16) << "path" << std::right
+            << std::setw(10) << "render s" << std::setw(10) << "Mpixel/s" << std::setw(10) << "baseline"
+            << std::setw(10) << "change %" << std::setw(10) << "max diff" << std::setw(12) << "bad pixels" << "  result" << std::endl;
+
+        // Images of the first run and the fastest time of every path. The runs go round the paths, so that a
+        // slow spell of the machine spreads over all of them instead of failing one. The reference only
+        // provides the images, it is rendered once and kept out of the baseline.
+        std::vector<vector<RenderResult*>> images(paths.size());
+        std::vector<double> seconds(paths.size(), 0.0);
+        for (int run = 0; run < regression.runs; run++) {
+            for (size_t p = run == 0 ? 0 : 1; p < paths.size(); p++) {
+                RayTracer rayTracer(paths[p].settings);
+                vector<RenderResult*> results = paths[p].progressive ? rayTracer.renderProgressive(scene, nullptr) : rayTracer.render(scene);
+                double renderSeconds = rayTracer.getStats().render_seconds;
+                seconds[p] = run == 0 ? renderSeconds : std::min(seconds[p], renderSeconds);
+                if (run == 0) {
+                    images[p] = results;
+                }
+                else {
+                    deleteResults(results);
+                }
+            }
+        }
+
+        const vector<RenderResult*>& reference = images[0];
+        for (size_t p = 0; p < paths.size(); p++) {
+            const RenderPath& path = paths[p];
+            ImageDifference difference = compareImages(reference, images[p], regression.pixel_tolerance);
+            double throughput = seconds[p] > 0 ? pixels / seconds[p] / 1e6 : 0.0;
+            if (p > 0) {
+                measured.throughput[{sceneName, path.name}] = throughput;
+            }
+
+            bool imageFailed = difference.failed_pixels > 0;
+            bool slower = false;
+            out << std::left << std::setw(16) << path.name << std::right
+                << std::setw(10) << seconds[p] << std::setw(10) << throughput;
+            auto known = baseline.throughput.find({sceneName, path.name});
+            if (checkBaseline && known != baseline.throughput.end()) {
+                double change = known->second > 0 ? 100.0 * (throughput / known->second - 1) : 0.0;
+                slower = change < -regression.max_slowdown_percent;
+                out << std::setw(10) << known->second << std::setw(10) << change;
+            }
+            else {
+                out << std::setw(10) << "-" << std::setw(10) << "-";
+            }
+            out << std::setw(10) << difference.max_difference << std::setw(12) << difference.failed_pixels << "  "
+                << (imageFailed ? "FAIL image" : slower ? "FAIL slower" : "ok") << std::endl;
+            if (imageFailed || slower) {
+                failures++;
+            }
+        }
+        for (vector<RenderResult*>& results : images) {
+            deleteResults(results);
+        }
+        out << std::endl;
+    }
+    out.flags(flags);
+
+    if (!checkBaseline) {
+        writeBaseline(regression.baseline_path, measured);
+        out << "baseline written to " << regression.baseline_path << std::endl;
+    }
+    out << failures << " of " << scenePaths.size() * paths.size() << " renders regressed, tolerance "
+        << regression.pixel_tolerance << ", slowdown limit " << regression.max_slowdown_percent << "%" << std::endl;
+
+    if (!corpusDirectory.empty()) {
+        std::filesystem::remove_all(corpusDirectory);
+    }
+    return failures == 0;
+}
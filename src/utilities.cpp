@@ -1,4 +1,5 @@
 #include "../include/utilities.h"
+#include <algorithm>
 
 // Define the constructor for Vec3f
 Vec3f::Vec3f(float x, float y, float z) : x(x), y(y), z(z) {}
@@ -67,3 +68,19 @@ Vec3f Vec3f::normalized() const {
     float oldLength = length();
     return Vec3f(x / oldLength, y / oldLength, z / oldLength);
 }
+
+// An empty box, expanding it by any point makes it that point
+BoundingBox::BoundingBox()
+    : min(INFINITY, INFINITY, INFINITY), max(-INFINITY, -INFINITY, -INFINITY) {}
+
+BoundingBox::BoundingBox(const Vec3f& min, const Vec3f& max) : min(min), max(max) {}
+
+void BoundingBox::expand(const Vec3f& point) {
+    min = Vec3f(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+    max = Vec3f(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+}
+
+void BoundingBox::expand(const BoundingBox& other) {
+    expand(other.min);
+    expand(other.max);
+}